@@ -0,0 +1,1834 @@
+#include "codegen.h"
+
+#include <cctype>
+#include <iterator>
+#include <cstdint>
+#include <ios>
+#include <algorithm>
+#include <functional>
+#include <array>
+
+//everything the emit functions need to know about the lexer being generated
+struct lexer_info
+{
+	const insert_order_map<std::string, token_data>& token_map;
+	const Lexer_Dfa& dfa;
+	const keyword_table& keywords;
+	bool keyword_split;
+	bool bit_parallel;
+	bool nfa_fallback;
+	bool captures;
+	bool trailing_context;
+	bool backtrack_free;
+	bool composed;
+	const dfa_profile* profile;
+	std::vector<size_t> skip_states; //hot self looping states scanned with rec_skip
+	std::vector<std::string> conditions; //start conditions, empty if the spec only uses initial
+};
+
+//converts a token name into the identifier used for it in the generated code
+static std::string enum_name(const std::string& name)
+{
+	std::string ret = "REC_TK_";
+	for(char ch : name) ret += ch == '-' ? '_' : static_cast<char>(std::toupper(ch));
+	return ret;
+}
+
+//converts a start condition name into the identifier used for it in the generated code
+static std::string condition_name(const std::string& name)
+{
+	std::string ret = "REC_COND_";
+	for(char ch : name) ret += ch == '-' ? '_' : static_cast<char>(std::toupper(ch));
+	return ret;
+}
+
+//the cond parameter of the matchers when the spec has start conditions
+static const char* condition_param(const lexer_info& info)
+{
+	return info.conditions.empty() ? "" : ", int cond";
+}
+
+//the state a scan starts from
+static const char* start_code(const lexer_info& info)
+{
+	return info.conditions.empty() ? "REC_START_STATE" : "rec_cond_start[cond]";
+}
+
+//writes str as a c string literal, bytes that aren't printable are octal escaped
+static void emit_string(std::ostream& os, const std::string& str)
+{
+	static const char digits[] = "01234567";
+	os << '"';
+	for(char ch : str)
+	{
+		unsigned char uch = static_cast<unsigned char>(ch);
+		if(uch >= ' ' && uch < 127 && ch != '"' && ch != '\\' && ch != '?')
+		{
+			os << ch;
+		}else
+		{
+			os << '\\' << digits[uch >> 6] << digits[(uch >> 3) & 7] << digits[uch & 7];
+		}
+	}
+	os << '"';
+}
+
+static const char* mode_name(token_data::lex_mode mode)
+{
+	switch(mode)
+	{
+	default:
+	case token_data::lex_mode::standard: return "REC_MODE_STANDARD";
+	case token_data::lex_mode::save: return "REC_MODE_SAVE";
+	case token_data::lex_mode::ignore: return "REC_MODE_IGNORE";
+	case token_data::lex_mode::error: return "REC_MODE_ERROR";
+	}
+}
+
+//wraps a branch condition in REC_LIKELY or REC_UNLIKELY when the profile shows it is
+//almost always or almost never taken
+static std::string branch(const lexer_info& info, size_t taken, size_t total, const std::string& cond)
+{
+	if(info.profile == nullptr || total == 0) return cond;
+	double ratio = static_cast<double>(taken)/total;
+	if(ratio <= 0.2) return "REC_UNLIKELY(" + cond + ")";
+	if(ratio >= 0.8) return "REC_LIKELY(" + cond + ")";
+	return cond;
+}
+
+//the states whose self loops take up a large share of the profiled scan, a run of bytes
+//looping on such a state is consumed by a tight loop over a 256 byte class table
+static std::vector<size_t> hot_loops(const Lexer_Dfa& dfa, const dfa_profile* profile)
+{
+	std::vector<size_t> ret;
+	if(profile == nullptr) return ret;
+	const std::vector<Lexer_Dfa::state>& states = dfa;
+	size_t total = 0;
+	std::vector<std::pair<size_t, size_t>> loops; //self transitions, state
+	for(size_t i = Lexer_Dfa::start_state; i < states.size(); i++)
+	{
+		size_t self = 0;
+		for(unsigned int ch = 0; ch < 256; ch++)
+		{
+			total += profile->transition_hits[i][ch];
+			if(states[i].transitions[ch] == i) self += profile->transition_hits[i][ch];
+		}
+		//a start state looping would mean a token of its own
+		if(std::find(dfa.starts().cbegin(), dfa.starts().cend(), i) != dfa.starts().cend() || self == 0) continue;
+		//worth a loop if runs are at least 4 bytes long on average
+		if(self >= 4*(profile->state_hits[i]-self)) loops.emplace_back(self, i);
+	}
+	std::sort(loops.begin(), loops.end(), std::greater<>());
+	for(const auto& [self, i] : loops)
+	{
+		if(ret.size() == 8 || self*100 < total) break;
+		ret.push_back(i);
+	}
+	return ret;
+}
+
+//the code consuming a run of a hot self loop after entering state s at byte i
+static std::string skip_code(const lexer_info& info, const char* indent)
+{
+	std::string ret;
+	for(size_t k = 0; k < info.skip_states.size(); k++)
+	{
+		ret += indent;
+		if(k > 0) ret += "else ";
+		ret += "if(s == " + std::to_string(info.skip_states[k]) + ") while(i + 1 < len && rec_skip[";
+		ret += std::to_string(k) + "][buf[i + 1]]) i++;\n";
+	}
+	return ret;
+}
+
+static void emit_header(std::ostream& os, const lexer_info& info)
+{
+	const insert_order_map<std::string, token_data>& token_map = info.token_map;
+	os << "/* generated by rec, do not edit */\n"
+		"#ifndef REC_LEXER_H\n"
+		"#define REC_LEXER_H\n\n"
+		"#include <stddef.h>\n"
+		"#include <stdint.h>\n"
+		"#include <string.h>\n\n";
+	os << "enum rec_token_kind\n{\n";
+	size_t i = 0;
+	for(const auto& [k, v] : token_map) os << '\t' << enum_name(k) << " = " << i++ << ",\n";
+	os << "\tREC_EOF = " << i << ",\n";
+	os << "\tREC_UNMATCHED = " << i+1 << "\n};\n\n";
+	os << "/* smallest type holding every token kind, used by the batch interface */\n";
+	if(i+1 <= 0xff) os << "typedef uint8_t rec_kind;\n\n";
+	else if(i+1 <= 0xffff) os << "typedef uint16_t rec_kind;\n\n";
+	else os << "typedef uint32_t rec_kind;\n\n";
+	os << "enum rec_lex_mode\n{\n"
+		"\tREC_MODE_STANDARD, REC_MODE_SAVE, REC_MODE_IGNORE, REC_MODE_ERROR\n};\n\n";
+	if(!info.conditions.empty())
+	{
+		os << "/* start conditions, a token is only matched in the ones its rule is active in */\n";
+		os << "enum rec_condition\n{\n";
+		for(size_t c = 0; c < info.conditions.size(); c++)
+		{
+			os << '\t' << condition_name(info.conditions[c]) << " = " << c << (c+1 < info.conditions.size() ? ",\n" : "\n");
+		}
+		os << "};\n\n";
+		os << "#define REC_COND_COUNT " << info.conditions.size() << "u\n\n";
+	}
+	os << "typedef struct rec_token\n{\n"
+		"\tint kind;\n"
+		"\tsize_t start;\n"
+		"\tsize_t length;\n"
+		"} rec_token;\n\n";
+	os << "typedef struct rec_lexer\n{\n"
+		"\tconst unsigned char* buf;\n"
+		"\tsize_t len;\n"
+		"\tsize_t pos;\n";
+	if(!info.conditions.empty()) os << "\tint cond; /* start condition, see rec_begin */\n";
+	if(!info.backtrack_free) os << "\tunsigned char* memo; /* see rec_set_memo */\n";
+	os << "} rec_lexer;\n\n";
+	os << "static const char* const rec_token_names[] =\n{\n";
+	for(const auto& [k, v] : token_map) os << "\t\"" << k << "\",\n";
+	os << "\t\"EOF\",\n\t\"UNMATCHED\"\n};\n\n";
+	os << "static const unsigned char rec_token_modes[] =\n{\n";
+	for(const auto& [k, v] : token_map) os << '\t' << mode_name(v.mode) << ",\n";
+	os << "\tREC_MODE_STANDARD,\n\tREC_MODE_ERROR\n};\n\n";
+	os << "/* called by rec_next and rec_next_batch for every token in error mode ('!' in the spec)\n"
+		"   and every byte no token matches (REC_UNMATCHED), a failed scan stops as soon as it\n"
+		"   falls into the dead state, define it before including the lexer to hook errors */\n";
+	os << "#ifndef REC_ON_ERROR\n"
+		"#define REC_ON_ERROR(kind, start, length) ((void)0)\n"
+		"#endif\n\n";
+}
+
+//counters of what the lexer spends its time on, compiled in only when REC_STATS is defined
+//so a production build can be measured and the spec tuned without a profiler, the hooks are
+//REC_STAT(...) statements that expand to nothing otherwise
+static void emit_stats(std::ostream& os, const lexer_info& info)
+{
+	os << "/* define REC_STATS before including the lexer to count tokens per kind, bytes per mode,\n"
+		"   bytes scanned past token ends (backtracking), the longest lexeme and the clock ticks\n"
+		"   spent matching ignored tokens, in rec_stats_counters, one copy per translation unit\n"
+		"   and not synchronized, REC_STATS_CLOCK() can be defined to another tick source,\n"
+		"   rec_lex_parallel and rec_lex_composed lex their chunks on several threads and aren't\n"
+		"   counted, nor is rec_lex_chunk or rec_reconcile when called from your own threads */\n";
+	os << "#ifdef REC_STATS\n"
+		"#include <stdio.h>\n"
+		"#ifndef REC_STATS_CLOCK\n"
+		"#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))\n"
+		"#define REC_STATS_CLOCK() ((uint64_t)__builtin_ia32_rdtsc())\n"
+		"#else\n"
+		"#include <time.h>\n"
+		"#define REC_STATS_CLOCK() ((uint64_t)clock())\n"
+		"#endif\n"
+		"#endif\n\n";
+	os << "typedef struct rec_stats\n{\n"
+		"\tuint64_t tokens[" << info.token_map.size()+2 << "]; /* by kind, ignored and unmatched ones included */\n"
+		"\tuint64_t mode_bytes[4]; /* by enum rec_lex_mode */\n"
+		"\tuint64_t backtracks; /* scans that went past the end of their token */\n"
+		"\tuint64_t backtrack_bytes; /* bytes those scans read past it */\n"
+		"\tuint64_t max_lexeme;\n"
+		"\tuint64_t ignore_ticks; /* REC_STATS_CLOCK ticks spent matching ignored tokens */\n"
+		"\tuint64_t clock; /* when the current match started */\n"
+		"\tunsigned int paused; /* nonzero while rec_lex_parallel or rec_lex_composed runs */\n"
+		"} rec_stats;\n\n";
+	os << "static rec_stats rec_stats_counters;\n\n";
+	os << "#define REC_STAT(stmt) do { stmt; } while(0)\n\n";
+	os << "static inline void rec_stats_token(int kind, size_t length)\n{\n"
+		"\trec_stats_counters.tokens[kind]++;\n"
+		"\trec_stats_counters.mode_bytes[rec_token_modes[kind]] += length;\n"
+		"\tif(length > rec_stats_counters.max_lexeme) rec_stats_counters.max_lexeme = length;\n"
+		"\tif(rec_token_modes[kind] == REC_MODE_IGNORE) rec_stats_counters.ignore_ticks += REC_STATS_CLOCK() - rec_stats_counters.clock;\n"
+		"}\n\n";
+	os << "static inline void rec_stats_reset(void)\n{\n"
+		"\tmemset(&rec_stats_counters, 0, sizeof(rec_stats_counters));\n"
+		"}\n\n";
+	os << "/* writes the counters as text, kinds that never matched are left out */\n";
+	os << "static inline void rec_stats_dump(FILE* out)\n{\n"
+		"\tstatic const char* const modes[4] = {\"standard\", \"save\", \"ignore\", \"error\"};\n"
+		"\tsize_t i;\n"
+		"\tfor(i = 0; i < sizeof(rec_stats_counters.tokens) / sizeof(*rec_stats_counters.tokens); i++)\n\t{\n"
+		"\t\tif(rec_stats_counters.tokens[i]) fprintf(out, \"tokens %s %llu\\n\", rec_token_names[i], (unsigned long long)rec_stats_counters.tokens[i]);\n"
+		"\t}\n"
+		"\tfor(i = 0; i < 4; i++) fprintf(out, \"bytes %s %llu\\n\", modes[i], (unsigned long long)rec_stats_counters.mode_bytes[i]);\n"
+		"\tfprintf(out, \"backtracks %llu\\n\", (unsigned long long)rec_stats_counters.backtracks);\n"
+		"\tfprintf(out, \"backtrack bytes %llu\\n\", (unsigned long long)rec_stats_counters.backtrack_bytes);\n"
+		"\tfprintf(out, \"max lexeme %llu\\n\", (unsigned long long)rec_stats_counters.max_lexeme);\n"
+		"\tfprintf(out, \"ignore ticks %llu\\n\", (unsigned long long)rec_stats_counters.ignore_ticks);\n"
+		"}\n"
+		"#else\n"
+		"#define REC_STAT(stmt) ((void)0)\n"
+		"#endif\n\n";
+}
+
+static void emit_tables(std::ostream& os, const lexer_info& info)
+{
+	const std::vector<Lexer_Dfa::state>& states = info.dfa;
+	os << "#define REC_DEAD_STATE " << Lexer_Dfa::dead_state << '\n';
+	os << "#define REC_START_STATE " << Lexer_Dfa::start_state << "\n\n";
+	os << "/* smallest type holding every state index, a row of the transition table is 256 of them */\n";
+	if(states.size() <= 0x100) os << "typedef uint8_t rec_state;\n\n";
+	else if(states.size() <= 0x10000) os << "typedef uint16_t rec_state;\n\n";
+	else os << "typedef uint32_t rec_state;\n\n";
+	os << "#if defined(__GNUC__) || defined(__clang__)\n"
+		"#define REC_ALIGNED __attribute__((aligned(64)))\n"
+		"#else\n"
+		"#define REC_ALIGNED\n"
+		"#endif\n\n";
+	if(info.profile != nullptr)
+	{
+		os << "#if defined(__GNUC__) || defined(__clang__)\n"
+			"#define REC_LIKELY(x) __builtin_expect(!!(x), 1)\n"
+			"#define REC_UNLIKELY(x) __builtin_expect(!!(x), 0)\n"
+			"#else\n"
+			"#define REC_LIKELY(x) (x)\n"
+			"#define REC_UNLIKELY(x) (x)\n"
+			"#endif\n\n";
+	}
+	os << "/* rows are ordered hottest first so the states a scan spends its time in share cache\n"
+		"   lines, what they accept is kept apart in rec_accept */\n";
+	os << "static const rec_state rec_transitions[" << states.size() << "][256] REC_ALIGNED =\n{\n";
+	for(const Lexer_Dfa::state& s : states)
+	{
+		os << "\t{";
+		for(unsigned int ch = 0; ch < 256; ch++)
+		{
+			if(ch % 32 == 0) os << "\n\t\t";
+			os << s.transitions[ch] << (ch < 255 ? "," : "");
+		}
+		os << "\n\t},\n";
+	}
+	os << "};\n\n";
+	os << "/* accepted token kind of each state, -1 if the state is not accepting */\n";
+	os << "static const int rec_accept[" << states.size() << "] =\n{";
+	for(size_t i = 0; i < states.size(); i++)
+	{
+		if(i % 16 == 0) os << "\n\t";
+		if(states[i].token == Lexer_Dfa::no_token) os << -1;
+		else os << enum_name(std::next(info.token_map.begin(), states[i].token)->first);
+		os << (i+1 < states.size() ? ", " : "");
+	}
+	os << "\n};\n\n";
+	if(info.trailing_context)
+	{
+		os << "/* trailing context of each kind, the lexeme is the first rec_trail[kind] bytes of the\n"
+			"   match if it's positive and the match without its last -rec_trail[kind] bytes if it's\n"
+			"   negative, the context still counts toward the longest match */\n";
+		os << "static const long rec_trail[" << info.token_map.size()+2 << "] =\n{";
+		size_t i = 0;
+		for(const auto& [k, v] : info.token_map)
+		{
+			if(i++ % 16 == 0) os << "\n\t";
+			os << v.trail << ", ";
+		}
+		os << "0, 0\n};\n\n";
+	}
+	if(!info.conditions.empty())
+	{
+		os << "/* start state of each start condition */\n";
+		os << "static const rec_state rec_cond_start[REC_COND_COUNT] =\n{";
+		for(size_t c = 0; c < info.conditions.size(); c++)
+		{
+			if(c % 16 == 0) os << "\n\t";
+			os << info.dfa.start(c) << (c+1 < info.conditions.size() ? ", " : "");
+		}
+		os << "\n};\n\n";
+		std::vector<size_t> switches = condition_switches(info.token_map);
+		os << "/* start condition each kind switches to once it is matched, -1 to stay */\n";
+		os << "static const int rec_token_begin[" << info.token_map.size()+2 << "] =\n{";
+		for(size_t i = 0; i < switches.size(); i++)
+		{
+			if(i % 16 == 0) os << "\n\t";
+			if(switches[i] == no_condition) os << -1;
+			else os << condition_name(info.conditions[switches[i]]);
+			os << ", ";
+		}
+		os << "-1, -1\n};\n\n";
+		if(info.bit_parallel || info.nfa_fallback)
+		{
+			os << "/* start conditions each kind is active in, bit c for condition c */\n";
+			os << "static const uint64_t rec_token_conds[" << info.token_map.size() << "] =\n{";
+			size_t i = 0;
+			for(const auto& [k, v] : info.token_map)
+			{
+				uint64_t mask = 0;
+				for(size_t c = 0; c < info.conditions.size(); c++)
+				{
+					if(active_in(v, info.conditions[c])) mask |= uint64_t(1) << c;
+				}
+				if(i % 8 == 0) os << "\n\t";
+				os << "0x" << std::hex << mask << std::dec << "ull" << (++i < info.token_map.size() ? ", " : "");
+			}
+			os << "\n};\n\n";
+		}
+	}
+	if(info.skip_states.empty()) return;
+	os << "/* bytes keeping each profiled hot state in its self loop */\n";
+	os << "static const unsigned char rec_skip[" << info.skip_states.size() << "][256] REC_ALIGNED =\n{\n";
+	for(size_t s : info.skip_states)
+	{
+		os << "\t{";
+		for(unsigned int ch = 0; ch < 256; ch++)
+		{
+			if(ch % 32 == 0) os << "\n\t\t";
+			os << (states[s].transitions[ch] == s) << (ch < 255 ? "," : "");
+		}
+		os << "\n\t},\n";
+	}
+	os << "};\n\n";
+}
+
+static void emit_keywords(std::ostream& os, const lexer_info& info)
+{
+	const insert_order_map<std::string, token_data>& token_map = info.token_map;
+	const keyword_table& keywords = info.keywords;
+	std::vector<bool> hosts(token_map.size()+2, false);
+	for(const keyword& k : keywords.keywords) hosts[k.host] = true;
+	os << "/* keywords left out of the dfa, a lexeme of a host token is looked up in a minimal\n"
+		"   perfect hash to recover the keyword it spells */\n";
+	os << "#define REC_KEYWORD_COUNT " << keywords.keywords.size() << "u\n";
+	os << "#define REC_KEYWORD_BUCKETS " << keywords.displacements.size() << "u\n\n";
+	os << "typedef struct rec_keyword_entry\n{\n"
+		"\tconst char* str;\n"
+		"\tsize_t len;\n"
+		"\tint host;\n"
+		"\tint kind;\n"
+		"} rec_keyword_entry;\n\n";
+	os << "static const unsigned char rec_keyword_hosts[] =\n{";
+	for(size_t i = 0; i < hosts.size(); i++)
+	{
+		if(i % 32 == 0) os << "\n\t";
+		os << hosts[i] << (i+1 < hosts.size() ? ", " : "");
+	}
+	os << "\n};\n\n";
+	os << "static const uint32_t rec_keyword_displacements[REC_KEYWORD_BUCKETS] =\n{";
+	for(size_t i = 0; i < keywords.displacements.size(); i++)
+	{
+		if(i % 16 == 0) os << "\n\t";
+		os << keywords.displacements[i] << 'u' << (i+1 < keywords.displacements.size() ? ", " : "");
+	}
+	os << "\n};\n\n";
+	os << "static const rec_keyword_entry rec_keywords[REC_KEYWORD_COUNT] =\n{\n";
+	for(const keyword& k : keywords.keywords)
+	{
+		os << "\t{";
+		emit_string(os, k.literal);
+		os << ", " << k.literal.size() << ", " << enum_name(std::next(token_map.begin(), k.host)->first);
+		os << ", " << enum_name(std::next(token_map.begin(), k.token)->first) << "},\n";
+	}
+	os << "};\n\n";
+	os << "static inline uint32_t rec_keyword_hash(const unsigned char* s, size_t len)\n{\n"
+		"\tuint32_t h = 2166136261u ^ " << keywords.seed << "u;\n"
+		"\tsize_t i;\n"
+		"\tfor(i = 0; i < len; i++)\n\t{\n"
+		"\t\th ^= s[i];\n"
+		"\t\th *= 16777619u;\n"
+		"\t}\n"
+		"\th ^= rec_keyword_displacements[h % REC_KEYWORD_BUCKETS];\n"
+		"\th ^= h >> 16;\n"
+		"\th *= 0x7feb352du;\n"
+		"\th ^= h >> 15;\n"
+		"\th *= 0x846ca68bu;\n"
+		"\th ^= h >> 16;\n"
+		"\treturn h % REC_KEYWORD_COUNT;\n"
+		"}\n\n";
+	os << "/* returns the keyword spelled by a lexeme of the host token kind, or kind if there is none */\n";
+	os << "static inline int rec_keyword(int kind, const unsigned char* s, size_t len)\n{\n"
+		"\tconst rec_keyword_entry* k = &rec_keywords[rec_keyword_hash(s, len)];\n"
+		"\tif(k->host == kind && k->len == len && memcmp(k->str, s, len) == 0) return k->kind;\n"
+		"\treturn kind;\n"
+		"}\n\n";
+}
+
+static void emit_mask(std::ostream& os, uint64_t mask)
+{
+	os << "0x" << std::hex << mask << std::dec << "ull";
+}
+
+//skips a simulated rule that isn't active in the start condition, when var is given the
+//check goes between its declaration and the assignment that starts the rule's scan
+static std::string condition_skip(const lexer_info& info, const char* kind, const char* var = nullptr)
+{
+	if(info.conditions.empty()) return "";
+	std::string ret = std::string("\t\tif(!((rec_token_conds[") + kind + "] >> cond) & 1)) continue;\n";
+	if(var != nullptr) ret = ";\n" + ret + "\t\t" + var;
+	return ret;
+}
+
+//lets the simulated rules compete with the dfa's match ending at end
+static std::string simulated_code(const lexer_info& info, const char* end)
+{
+	std::string cond = info.conditions.empty() ? "" : ", cond";
+	std::string ret;
+	if(info.bit_parallel) ret += std::string("\trec_match_bit_parallel(buf, len, pos, &kind, &") + end + cond + ");\n";
+	if(info.nfa_fallback) ret += std::string("\trec_match_nfa(buf, len, pos, &kind, &") + end + cond + ");\n";
+	return ret;
+}
+
+//cuts the trailing context off a match ending at end, before the keyword lookup sees it
+static std::string trail_code(const lexer_info& info, const char* end)
+{
+	if(!info.trailing_context) return "";
+	return std::string("\tif(rec_trail[kind]) ") + end + " = rec_trail[kind] > 0 ? pos + (size_t)rec_trail[kind] : "
+		+ end + " - (size_t)-rec_trail[kind];\n";
+}
+
+//rules whose dfa blows up are simulated on their position automaton instead, a set of
+//positions fits in a 64 bit word and the positions following it are looked up one byte of
+//the word at a time, so memory is fixed by the number of positions
+static void emit_bit_parallel(std::ostream& os, const lexer_info& info)
+{
+	const insert_order_map<std::string, token_data>& token_map = info.token_map;
+	os << "/* rules simulated bit parallel instead of being part of the dfa, bit p of a mask is\n"
+		"   position p of the rule's position automaton, end is the bit of the end marker */\n";
+	os << "typedef struct rec_bit_parallel\n{\n"
+		"\tint kind;\n"
+		"\tuint64_t first;\n"
+		"\tuint64_t end;\n"
+		"\tsize_t chunks; /* bytes of a mask holding positions that match input */\n"
+		"\tconst uint64_t* bytes; /* positions matching each input byte */\n"
+		"\tconst uint64_t (*follow)[256]; /* follow[k][b] positions following the ones in byte k of a mask equal to b */\n"
+		"} rec_bit_parallel;\n\n";
+	size_t count = 0;
+	for(const auto& [k, v] : token_map)
+	{
+		if(!v.bit_parallel) continue;
+		const std::vector<Glushkov_Nfa::position>& positions = *v.bit_parallel;
+		size_t chunks = (v.bit_parallel->end_marker()+7)/8;
+		os << "static const uint64_t rec_bit_parallel_bytes_" << count << "[256] =\n{";
+		for(unsigned int ch = 0; ch < 256; ch++)
+		{
+			uint64_t mask = 0;
+			for(size_t p = 0; p < positions.size(); p++)
+			{
+				if(positions[p].set[ch]) mask |= uint64_t(1) << p;
+			}
+			if(ch % 8 == 0) os << "\n\t";
+			emit_mask(os, mask);
+			os << (ch < 255 ? ", " : "");
+		}
+		os << "\n};\n\n";
+		os << "static const uint64_t rec_bit_parallel_follow_" << count << "[" << chunks << "][256] =\n{\n";
+		for(size_t c = 0; c < chunks; c++)
+		{
+			os << "\t{";
+			for(unsigned int b = 0; b < 256; b++)
+			{
+				uint64_t mask = 0;
+				for(size_t j = 0; j < 8 && c*8+j < positions.size(); j++)
+				{
+					if(!((b >> j) & 1)) continue;
+					for(size_t f : positions[c*8+j].follow) mask |= uint64_t(1) << f;
+				}
+				if(b % 8 == 0) os << "\n\t\t";
+				emit_mask(os, mask);
+				os << (b < 255 ? ", " : "");
+			}
+			os << "\n\t},\n";
+		}
+		os << "};\n\n";
+		count++;
+	}
+	os << "#define REC_BIT_PARALLEL_COUNT " << count << "u\n\n";
+	os << "static const rec_bit_parallel rec_bit_parallel_rules[REC_BIT_PARALLEL_COUNT] =\n{\n";
+	count = 0;
+	for(const auto& [k, v] : token_map)
+	{
+		if(!v.bit_parallel) continue;
+		uint64_t first = 0;
+		for(size_t p : v.bit_parallel->first()) first |= uint64_t(1) << p;
+		os << "\t{" << enum_name(k) << ", ";
+		emit_mask(os, first);
+		os << ", ";
+		emit_mask(os, uint64_t(1) << v.bit_parallel->end_marker());
+		os << ", " << (v.bit_parallel->end_marker()+7)/8 << ", rec_bit_parallel_bytes_" << count;
+		os << ", rec_bit_parallel_follow_" << count << "},\n";
+		count++;
+	}
+	os << "};\n\n";
+	os << "/* returns the end of the longest match of the rule starting at pos, pos if there is none */\n";
+	os << "static inline size_t rec_bit_parallel_match(const rec_bit_parallel* r, const unsigned char* buf, size_t len, size_t pos)\n{\n"
+		"\tuint64_t next = r->first;\n"
+		"\tsize_t end = pos;\n"
+		"\tsize_t i;\n"
+		"\tsize_t k;\n"
+		"\tfor(i = pos; i < len; i++)\n\t{\n"
+		"\t\tuint64_t d = next & r->bytes[buf[i]];\n"
+		"\t\tif(!d) break;\n"
+		"\t\tnext = 0;\n"
+		"\t\tfor(k = 0; k < r->chunks; k++) next |= r->follow[k][(d >> (8 * k)) & 0xff];\n"
+		"\t\tif(next & r->end) end = i + 1;\n"
+		"\t}\n"
+		"\treturn end;\n"
+		"}\n\n";
+	os << "/* the bit parallel rules compete with the dfa's match, the longest match wins and the\n"
+		"   rule listed first breaks ties */\n";
+	os << "static inline void rec_match_bit_parallel(const unsigned char* buf, size_t len, size_t pos, int* kind, size_t* end"
+		<< condition_param(info) << ")\n{\n"
+		"\tsize_t r;\n"
+		"\tfor(r = 0; r < REC_BIT_PARALLEL_COUNT; r++)\n\t{\n"
+		"\t\tsize_t e" << condition_skip(info, "rec_bit_parallel_rules[r].kind", "e") <<
+		" = rec_bit_parallel_match(&rec_bit_parallel_rules[r], buf, len, pos);\n"
+		"\t\tif(e == pos) continue;\n"
+		"\t\tif(e > *end || (e == *end && rec_bit_parallel_rules[r].kind < *kind))\n\t\t{\n"
+		"\t\t\t*kind = rec_bit_parallel_rules[r].kind;\n"
+		"\t\t\t*end = e;\n"
+		"\t\t}\n"
+		"\t}\n"
+		"}\n\n";
+}
+
+//writes a constant uint32_t array, never empty since c doesn't allow zero length arrays
+static void emit_index_array(std::ostream& os, const std::string& name, std::vector<size_t> values)
+{
+	if(values.empty()) values.push_back(0);
+	os << "static const uint32_t " << name << "[" << values.size() << "] =\n{";
+	for(size_t i = 0; i < values.size(); i++)
+	{
+		if(i % 16 == 0) os << "\n\t";
+		os << values[i] << (i+1 < values.size() ? ", " : "");
+	}
+	os << "\n};\n\n";
+}
+
+//rules whose dfa went over the state budget are simulated on their thompson nfa with a pike
+//vm, one thread per nfa state kept in a sparse set so a byte costs at most one step per state
+static void emit_nfa(std::ostream& os, const lexer_info& info)
+{
+	const insert_order_map<std::string, token_data>& token_map = info.token_map;
+	os << "/* rules simulated on their nfa instead of being part of the dfa, the epsilon edges of\n"
+		"   state s are eps[eps_begin[s]] up to eps[eps_begin[s + 1]], its byte edges likewise,\n"
+		"   an edge byte of 256 matches any byte */\n";
+	os << "typedef struct rec_nfa\n{\n"
+		"\tint kind;\n"
+		"\tuint32_t accept;\n"
+		"\tconst uint32_t* eps_begin;\n"
+		"\tconst uint32_t* eps;\n"
+		"\tconst uint32_t* edge_begin;\n"
+		"\tconst uint16_t* edge_bytes;\n"
+		"\tconst uint32_t* edge_targets;\n"
+		"} rec_nfa;\n\n";
+	size_t count = 0;
+	size_t max_states = 0;
+	std::vector<std::pair<std::string, size_t>> rules; //kind, accepting state
+	for(const auto& [k, v] : token_map)
+	{
+		if(!v.nfa_fallback) continue;
+		const std::vector<Nfa::state>& states = *v.nfa_fallback;
+		std::vector<size_t> eps_begin, eps, edge_begin, edge_bytes, edge_targets;
+		size_t accept = 0;
+		for(size_t s = 0; s < states.size(); s++)
+		{
+			if(states[s].is_accepting) accept = s;
+			eps_begin.push_back(eps.size());
+			eps.insert(eps.end(), states[s].epsilon_transitions.cbegin(), states[s].epsilon_transitions.cend());
+			edge_begin.push_back(edge_targets.size());
+			for(const auto& [ch, t] : states[s].ch_transitions)
+			{
+				edge_bytes.push_back(static_cast<unsigned char>(ch));
+				edge_targets.push_back(t);
+			}
+			for(size_t t : states[s].omega_transitions)
+			{
+				edge_bytes.push_back(256);
+				edge_targets.push_back(t);
+			}
+		}
+		eps_begin.push_back(eps.size());
+		edge_begin.push_back(edge_targets.size());
+		const std::string n = std::to_string(count);
+		emit_index_array(os, "rec_nfa_eps_begin_" + n, std::move(eps_begin));
+		emit_index_array(os, "rec_nfa_eps_" + n, std::move(eps));
+		emit_index_array(os, "rec_nfa_edge_begin_" + n, std::move(edge_begin));
+		emit_index_array(os, "rec_nfa_edge_targets_" + n, std::move(edge_targets));
+		if(edge_bytes.empty()) edge_bytes.push_back(0);
+		os << "static const uint16_t rec_nfa_edge_bytes_" << n << "[" << edge_bytes.size() << "] =\n{";
+		for(size_t i = 0; i < edge_bytes.size(); i++)
+		{
+			if(i % 16 == 0) os << "\n\t";
+			os << edge_bytes[i] << (i+1 < edge_bytes.size() ? ", " : "");
+		}
+		os << "\n};\n\n";
+		rules.emplace_back(enum_name(k), accept);
+		max_states = std::max(max_states, states.size());
+		count++;
+	}
+	os << "#define REC_NFA_COUNT " << count << "u\n";
+	os << "#define REC_NFA_MAX_STATES " << max_states << "u\n\n";
+	os << "static const rec_nfa rec_nfa_rules[REC_NFA_COUNT] =\n{\n";
+	for(size_t r = 0; r < rules.size(); r++)
+	{
+		const std::string n = std::to_string(r);
+		os << "\t{" << rules[r].first << ", " << rules[r].second << ", rec_nfa_eps_begin_" << n << ", rec_nfa_eps_" << n;
+		os << ", rec_nfa_edge_begin_" << n << ", rec_nfa_edge_bytes_" << n << ", rec_nfa_edge_targets_" << n << "},\n";
+	}
+	os << "};\n\n";
+	os << "/* a set of nfa states (briggs and torczon), members are dense[0] up to dense[count] in\n"
+		"   the order they were added, emptying it only resets count */\n";
+	os << "typedef struct rec_nfa_set\n{\n"
+		"\tuint32_t count;\n"
+		"\tuint32_t dense[REC_NFA_MAX_STATES];\n"
+		"\tuint32_t sparse[REC_NFA_MAX_STATES];\n"
+		"} rec_nfa_set;\n\n";
+	os << "static inline int rec_nfa_set_has(const rec_nfa_set* set, uint32_t s)\n{\n"
+		"\treturn set->sparse[s] < set->count && set->dense[set->sparse[s]] == s;\n"
+		"}\n\n";
+	os << "static inline void rec_nfa_set_add(rec_nfa_set* set, uint32_t s)\n{\n"
+		"\tset->sparse[s] = set->count;\n"
+		"\tset->dense[set->count++] = s;\n"
+		"}\n\n";
+	os << "/* adds a thread for s and every state its epsilon edges reach, a state is only pushed\n"
+		"   when it joins the set so the stack never holds more than REC_NFA_MAX_STATES */\n";
+	os << "static inline void rec_nfa_add(const rec_nfa* r, rec_nfa_set* set, uint32_t s, uint32_t* stack)\n{\n"
+		"\tsize_t top = 0;\n"
+		"\tuint32_t e;\n"
+		"\tif(rec_nfa_set_has(set, s)) return;\n"
+		"\trec_nfa_set_add(set, s);\n"
+		"\tstack[top++] = s;\n"
+		"\twhile(top)\n\t{\n"
+		"\t\ts = stack[--top];\n"
+		"\t\tfor(e = r->eps_begin[s]; e < r->eps_begin[s + 1]; e++)\n\t\t{\n"
+		"\t\t\tif(rec_nfa_set_has(set, r->eps[e])) continue;\n"
+		"\t\t\trec_nfa_set_add(set, r->eps[e]);\n"
+		"\t\t\tstack[top++] = r->eps[e];\n"
+		"\t\t}\n"
+		"\t}\n"
+		"}\n\n";
+	os << "/* returns the end of the longest match of the rule starting at pos, pos if there is none,\n"
+		"   and stores one past the last byte the scan read in reach (see rec_reach) unless it's NULL */\n";
+	os << "static inline size_t rec_nfa_match(const rec_nfa* r, const unsigned char* buf, size_t len, size_t pos, size_t* reach)\n{\n"
+		"\trec_nfa_set sets[2];\n"
+		"\tuint32_t stack[REC_NFA_MAX_STATES];\n"
+		"\trec_nfa_set* cur = &sets[0];\n"
+		"\trec_nfa_set* next = &sets[1];\n"
+		"\tsize_t end = pos;\n"
+		"\tsize_t i;\n"
+		"\t/* sparse is only cleared once per match, every step after that empties a set in O(1) */\n"
+		"\tmemset(sets[0].sparse, 0, sizeof(sets[0].sparse));\n"
+		"\tmemset(sets[1].sparse, 0, sizeof(sets[1].sparse));\n"
+		"\tcur->count = 0;\n"
+		"\trec_nfa_add(r, cur, 0, stack);\n"
+		"\tfor(i = pos; i < len && cur->count; i++)\n\t{\n"
+		"\t\trec_nfa_set* t;\n"
+		"\t\tuint32_t k;\n"
+		"\t\tnext->count = 0;\n"
+		"\t\tfor(k = 0; k < cur->count; k++)\n\t\t{\n"
+		"\t\t\tuint32_t s = cur->dense[k];\n"
+		"\t\t\tuint32_t e;\n"
+		"\t\t\tfor(e = r->edge_begin[s]; e < r->edge_begin[s + 1]; e++)\n\t\t\t{\n"
+		"\t\t\t\tif(r->edge_bytes[e] == buf[i] || r->edge_bytes[e] == 256) rec_nfa_add(r, next, r->edge_targets[e], stack);\n"
+		"\t\t\t}\n"
+		"\t\t}\n"
+		"\t\tt = cur;\n"
+		"\t\tcur = next;\n"
+		"\t\tnext = t;\n"
+		"\t\tif(rec_nfa_set_has(cur, r->accept)) end = i + 1;\n"
+		"\t}\n"
+		"\tif(reach) *reach = cur->count ? i + 1 : i;\n"
+		"\treturn end;\n"
+		"}\n\n";
+	os << "/* the nfa rules compete with the dfa's match like the bit parallel ones */\n";
+	os << "static inline void rec_match_nfa(const unsigned char* buf, size_t len, size_t pos, int* kind, size_t* end"
+		<< condition_param(info) << ")\n{\n"
+		"\tsize_t r;\n"
+		"\tfor(r = 0; r < REC_NFA_COUNT; r++)\n\t{\n"
+		"\t\tsize_t e" << condition_skip(info, "rec_nfa_rules[r].kind", "e") <<
+		" = rec_nfa_match(&rec_nfa_rules[r], buf, len, pos, NULL);\n"
+		"\t\tif(e == pos) continue;\n"
+		"\t\tif(e > *end || (e == *end && rec_nfa_rules[r].kind < *kind))\n\t\t{\n"
+		"\t\t\t*kind = rec_nfa_rules[r].kind;\n"
+		"\t\t\t*end = e;\n"
+		"\t\t}\n"
+		"\t}\n"
+		"}\n\n";
+}
+
+//capture groups are left out of the lexer dfa, which only has to find the token, each rule
+//with groups gets a tagged dfa that rec_captures runs over the lexeme afterwards, so lexing
+//costs the same and only the tokens whose groups are asked for pay for them
+static void emit_captures(std::ostream& os, const lexer_info& info)
+{
+	const insert_order_map<std::string, token_data>& token_map = info.token_map;
+	os << "/* capture groups of the rules that have them, every rule has a tagged dfa over byte\n"
+		"   classes, a transition of state s on class c goes to next[s * classes + c] and runs op\n"
+		"   list ops[s * classes + c], op list l is op[op_begin[l]] up to op[op_begin[l + 1]] */\n";
+	os << "#define REC_NO_CAPTURE ((size_t)-1)\n"
+		"#define REC_CAPTURE_DEAD 0xffffffffu\n\n";
+	os << "typedef struct rec_capture_op\n{\n"
+		"\tuint32_t dst;\n"
+		"\tuint32_t src;\n"
+		"\tuint64_t set; /* tags set to the position instead of copied from src */\n"
+		"} rec_capture_op;\n\n";
+	os << "typedef struct rec_capture_dfa\n{\n"
+		"\tuint32_t groups;\n"
+		"\tuint32_t registers;\n"
+		"\tuint32_t classes;\n"
+		"\tuint32_t initial; /* op list run before the first byte */\n"
+		"\tconst uint8_t* byte_class;\n"
+		"\tconst uint32_t* next;\n"
+		"\tconst uint32_t* ops;\n"
+		"\tconst uint32_t* final; /* register set holding the groups if the lexeme ends in the state */\n"
+		"\tconst uint32_t* op_begin;\n"
+		"\tconst rec_capture_op* op;\n"
+		"} rec_capture_dfa;\n\n";
+	auto index = [](size_t i){ return i == Tagged_Dfa::no_state ? 0xffffffffu : i; };
+	size_t count = 0;
+	size_t max_groups = 0;
+	size_t max_registers = 0;
+	std::vector<std::string> rules; //groups, registers, classes and initial op list
+	std::vector<long long> rule_of_kind;
+	for(const auto& [k, v] : token_map)
+	{
+		if(!v.captures)
+		{
+			rule_of_kind.push_back(-1);
+			continue;
+		}
+		const Tagged_Dfa& tdfa = *v.captures;
+		const std::string n = std::to_string(count);
+		os << "static const uint8_t rec_capture_class_" << n << "[256] =\n{";
+		for(size_t b = 0; b < 256; b++)
+		{
+			if(b % 16 == 0) os << "\n\t";
+			os << static_cast<unsigned int>(tdfa.byte_classes()[b]) << (b < 255 ? ", " : "");
+		}
+		os << "\n};\n\n";
+		std::vector<size_t> next, ops, final;
+		for(const Tagged_Dfa::state& s : tdfa.states())
+		{
+			for(size_t t : s.next) next.push_back(index(t));
+			for(size_t l : s.ops) ops.push_back(index(l));
+			final.push_back(index(s.final));
+		}
+		emit_index_array(os, "rec_capture_next_" + n, std::move(next));
+		emit_index_array(os, "rec_capture_ops_" + n, std::move(ops));
+		emit_index_array(os, "rec_capture_final_" + n, std::move(final));
+		std::vector<size_t> op_begin;
+		os << "static const rec_capture_op rec_capture_op_" << n << "[] =\n{\n";
+		size_t total = 0;
+		for(const std::vector<Tagged_Dfa::op>& list : tdfa.op_lists())
+		{
+			op_begin.push_back(total);
+			for(const Tagged_Dfa::op& o : list)
+			{
+				os << "\t{" << o.dst << ", " << o.src << ", ";
+				emit_mask(os, o.set);
+				os << "},\n";
+			}
+			total += list.size();
+		}
+		if(total == 0) os << "\t{0, 0, 0}\n";
+		os << "};\n\n";
+		op_begin.push_back(total);
+		emit_index_array(os, "rec_capture_op_begin_" + n, std::move(op_begin));
+		rules.push_back(std::to_string(tdfa.groups()) + ", " + std::to_string(tdfa.registers()) + ", " +
+			std::to_string(tdfa.class_count()) + ", " + std::to_string(tdfa.initial_ops()));
+		rule_of_kind.push_back(static_cast<long long>(count));
+		max_groups = std::max(max_groups, tdfa.groups());
+		max_registers = std::max(max_registers, (tdfa.registers()+1)*2*tdfa.groups());
+		count++;
+	}
+	os << "static const rec_capture_dfa rec_capture_dfas[" << count << "] =\n{\n";
+	for(size_t r = 0; r < rules.size(); r++)
+	{
+		const std::string n = std::to_string(r);
+		os << "\t{" << rules[r] << ", rec_capture_class_" << n << ", rec_capture_next_" << n << ", rec_capture_ops_" << n;
+		os << ", rec_capture_final_" << n << ", rec_capture_op_begin_" << n << ", rec_capture_op_" << n << "},\n";
+	}
+	os << "};\n\n";
+	os << "/* the tagged dfa of each kind in rec_capture_dfas, -1 for kinds without groups */\n";
+	os << "static const int rec_capture_rule[" << rule_of_kind.size() << "] =\n{";
+	for(size_t i = 0; i < rule_of_kind.size(); i++)
+	{
+		if(i % 16 == 0) os << "\n\t";
+		os << rule_of_kind[i] << (i+1 < rule_of_kind.size() ? ", " : "");
+	}
+	os << "\n};\n\n";
+	os << "#define REC_CAPTURE_MAX_GROUPS " << max_groups << "u\n";
+	os << "#define REC_CAPTURE_REGISTERS " << max_registers << "u\n\n";
+	os << "/* runs op list l, the register set of every thread the transition leads to is built from\n"
+		"   the set of the thread it came from with some tags set to pos */\n";
+	os << "static inline void rec_capture_run(const rec_capture_dfa* d, uint32_t l, const size_t* cur, size_t* next, size_t pos)\n{\n"
+		"\tsize_t tags = 2 * d->groups;\n"
+		"\tuint32_t o;\n"
+		"\tfor(o = d->op_begin[l]; o < d->op_begin[l + 1]; o++)\n\t{\n"
+		"\t\tconst rec_capture_op* op = &d->op[o];\n"
+		"\t\tsize_t t;\n"
+		"\t\tfor(t = 0; t < tags; t++) next[op->dst * tags + t] = (op->set >> t & 1) ? pos : cur[op->src * tags + t];\n"
+		"\t}\n"
+		"}\n\n";
+	os << "/* finds the capture groups of a token in one pass over its lexeme, group g starts at\n"
+		"   caps[2g - 2] and ends at caps[2g - 1] relative to the lexeme, REC_NO_CAPTURE if it took\n"
+		"   no part in the match, caps needs room for 2 * REC_CAPTURE_MAX_GROUPS offsets\n"
+		"   returns the number of groups, 0 for kinds without groups or a lexeme the kind doesn't match */\n";
+	os << "static inline size_t rec_captures(int kind, const unsigned char* lexeme, size_t length, size_t* caps)\n{\n"
+		"\tsize_t regs[2][REC_CAPTURE_REGISTERS];\n"
+		"\tsize_t* cur = regs[0];\n"
+		"\tsize_t* next = regs[1];\n"
+		"\tsize_t* t;\n"
+		"\tconst rec_capture_dfa* d;\n"
+		"\tsize_t tags, i, s = 0;\n"
+		"\tif(kind < 0 || kind >= " << rule_of_kind.size() << " || rec_capture_rule[kind] < 0) return 0;\n"
+		"\td = &rec_capture_dfas[rec_capture_rule[kind]];\n"
+		"\ttags = 2 * d->groups;\n"
+		"\t/* the register set past the last is never written, every tag unset */\n"
+		"\tfor(i = 0; i < tags; i++) cur[d->registers * tags + i] = next[d->registers * tags + i] = REC_NO_CAPTURE;\n"
+		"\trec_capture_run(d, d->initial, cur, next, 0);\n"
+		"\tt = cur;\n"
+		"\tcur = next;\n"
+		"\tnext = t;\n"
+		"\tfor(i = 0; i < length; i++)\n\t{\n"
+		"\t\tsize_t e = s * d->classes + d->byte_class[lexeme[i]];\n"
+		"\t\tif(d->next[e] == REC_CAPTURE_DEAD) return 0;\n"
+		"\t\trec_capture_run(d, d->ops[e], cur, next, i + 1);\n"
+		"\t\tt = cur;\n"
+		"\t\tcur = next;\n"
+		"\t\tnext = t;\n"
+		"\t\ts = d->next[e];\n"
+		"\t}\n"
+		"\tif(d->final[s] == REC_CAPTURE_DEAD) return 0;\n"
+		"\tmemcpy(caps, cur + d->final[s] * tags, tags * sizeof(size_t));\n"
+		"\treturn d->groups;\n"
+		"}\n\n";
+}
+
+//when the lexer can backtrack a scan may run far past the token it ends up returning, and
+//on inputs like aaaa...a for the rules a and a*b every token rescans the rest of the input,
+//rec_match_memo remembers which (state, position) pairs can't reach an accepting state
+//(reps' maximal munch in linear time) so no pair is scanned past twice, rules simulated
+//outside the dfa aren't memoized and still scan from every token start
+static void emit_memo(std::ostream& os, const lexer_info& info)
+{
+	const std::vector<Lexer_Dfa::state>& states = info.dfa;
+	std::vector<long> index(states.size(), -1);
+	long count = 0;
+	for(size_t i = Lexer_Dfa::start_state; i < states.size(); i++)
+	{
+		if(states[i].token == Lexer_Dfa::no_token) index[i] = count++;
+	}
+	os << "/* memo bit of each non accepting state, -1 for the rest */\n";
+	os << "#define REC_MEMO_STATES " << count << "u\n";
+	os << "#define REC_MEMO_BYTES(len) ((((size_t)(len) + 1) * REC_MEMO_STATES + 7) / 8)\n\n";
+	os << "static const int rec_memo_index[" << states.size() << "] =\n{";
+	for(size_t i = 0; i < states.size(); i++)
+	{
+		if(i % 16 == 0) os << "\n\t";
+		os << index[i] << (i+1 < states.size() ? ", " : "");
+	}
+	os << "\n};\n\n";
+	if(info.bit_parallel || info.nfa_fallback)
+	{
+		os << "/* makes the dfa scan of rec_next and rec_next_batch linear in the input, the rules\n"
+			"   simulated outside the dfa still scan from every token start, memo must hold\n"
+			"   REC_MEMO_BYTES(len) zeroed bytes and stay untouched until lexing is done */\n";
+	}else
+	{
+		os << "/* makes rec_next and rec_next_batch run in linear time on any input, memo must hold\n"
+			"   REC_MEMO_BYTES(len) zeroed bytes and stay untouched until lexing is done */\n";
+	}
+	os << "static inline void rec_set_memo(rec_lexer* lx, unsigned char* memo)\n{\n"
+		"\tlx->memo = memo;\n"
+		"}\n\n";
+	os << "static inline int rec_memo_failed(const unsigned char* memo, size_t s, size_t i)\n{\n"
+		"\tsize_t bit = i * REC_MEMO_STATES + (size_t)rec_memo_index[s];\n"
+		"\treturn (memo[bit >> 3] >> (bit & 7)) & 1;\n"
+		"}\n\n";
+	os << "static inline int rec_match_memo(const unsigned char* buf, size_t len, size_t pos, size_t* end_out, unsigned char* memo"
+		<< condition_param(info) << ")\n{\n"
+		"\tsize_t end = pos + 1;\n"
+		"\tsize_t i;\n"
+		"\tsize_t s = " << start_code(info) << ";\n"
+		"\tsize_t from = " << start_code(info) << "; /* state at the last accept (or pos) */\n"
+		"\tsize_t from_pos = pos;\n"
+		"\tint kind = REC_UNMATCHED;\n"
+		"\tfor(i = pos; i < len; i++)\n\t{\n"
+		"\t\ts = rec_transitions[s][buf[i]];\n"
+		"\t\tif(s == REC_DEAD_STATE) break;\n"
+		"\t\tif(rec_accept[s] >= 0)\n\t\t{\n"
+		"\t\t\tkind = rec_accept[s];\n"
+		"\t\t\tend = i + 1;\n"
+		"\t\t\tfrom = s;\n"
+		"\t\t\tfrom_pos = i + 1;\n"
+		"\t\t}else if(rec_memo_failed(memo, s, i + 1))\n\t\t{\n"
+		"\t\t\tbreak;\n"
+		"\t\t}\n"
+		"\t}\n"
+		"\tREC_STAT(if(i > end && !rec_stats_counters.paused) { rec_stats_counters.backtracks++; rec_stats_counters.backtrack_bytes += i - end; });\n"
+		"\t/* nothing after the last accept leads anywhere, remember that */\n"
+		"\tfor(s = from; from_pos < i; from_pos++)\n\t{\n"
+		"\t\tsize_t bit;\n"
+		"\t\ts = rec_transitions[s][buf[from_pos]];\n"
+		"\t\tbit = (from_pos + 1) * REC_MEMO_STATES + (size_t)rec_memo_index[s];\n"
+		"\t\tmemo[bit >> 3] |= (unsigned char)(1u << (bit & 7));\n"
+		"\t}\n";
+	os << simulated_code(info, "end");
+	os << trail_code(info, "end");
+	if(info.keyword_split) os << "\tif(rec_keyword_hosts[kind]) kind = rec_keyword(kind, buf + pos, end - pos);\n";
+	os << "\t*end_out = end;\n"
+		"\treturn kind;\n"
+		"}\n\n";
+}
+
+static void emit_functions(std::ostream& os, const lexer_info& info)
+{
+	//the memoized matcher replaces rec_match when the caller provides a memo
+	const std::string cond = info.conditions.empty() ? "" : ", lx->cond";
+	const std::string match = info.backtrack_free ? "rec_match(buf, len, pos, &end" + cond + ")"
+		: "lx->memo ? rec_match_memo(buf, len, pos, &end, lx->memo" + cond + ") : rec_match(buf, len, pos, &end" + cond + ")";
+	//a token's rule can switch the start condition the next token is matched in
+	const std::string begin = info.conditions.empty() ? "" : "\t\tif(rec_token_begin[kind] >= 0) lx->cond = rec_token_begin[kind];\n";
+	os << "static inline void rec_init(rec_lexer* lx, const char* buf, size_t len)\n{\n"
+		"\tlx->buf = (const unsigned char*)buf;\n"
+		"\tlx->len = len;\n"
+		"\tlx->pos = 0;\n";
+	if(!info.conditions.empty()) os << "\tlx->cond = REC_COND_INITIAL;\n";
+	if(!info.backtrack_free) os << "\tlx->memo = NULL;\n";
+	os << "}\n\n";
+	if(!info.conditions.empty())
+	{
+		os << "/* switches the start condition the next token is matched in */\n";
+		os << "static inline void rec_begin(rec_lexer* lx, int cond)\n{\n"
+			"\tlx->cond = cond;\n"
+			"}\n\n";
+	}
+	os << "/* matches the longest token starting at pos < len, stores where it ends and returns\n"
+		"   its kind, or REC_UNMATCHED ending at pos + 1 if no token starts there */\n";
+	os << "static inline int rec_match(const unsigned char* buf, size_t len, size_t pos, size_t* end_out" << condition_param(info) << ")\n{\n";
+	size_t transitions = 0;
+	size_t entered = 0;
+	if(info.profile != nullptr)
+	{
+		for(const std::array<size_t, 256>& t : info.profile->transition_hits)
+		{
+			for(size_t n : t) transitions += n;
+		}
+		entered = transitions-info.profile->dead_hits;
+	}
+	const std::string dead = branch(info, info.profile ? info.profile->dead_hits : 0, transitions, "t == REC_DEAD_STATE");
+	if(info.backtrack_free)
+	{
+		//every state that dies is accepting so the token ends wherever the scan stops
+		os << "\tsize_t i;\n"
+			"\tsize_t s = " << start_code(info) << ";\n"
+			"\tint kind;\n"
+			"\tfor(i = pos; i < len; i++)\n\t{\n"
+			"\t\tsize_t t = rec_transitions[s][buf[i]];\n"
+			"\t\tif(" << dead << ") break;\n"
+			"\t\ts = t;\n"
+			<< skip_code(info, "\t\t") <<
+			"\t}\n"
+			"\tkind = rec_accept[s];\n"
+			"\tif(kind < 0 || i == pos)\n\t{\n"
+			"\t\tkind = REC_UNMATCHED;\n"
+			"\t\ti = pos + 1;\n"
+			"\t}\n";
+		os << simulated_code(info, "i");
+		os << trail_code(info, "i");
+		if(info.keyword_split) os << "\tif(rec_keyword_hosts[kind]) kind = rec_keyword(kind, buf + pos, i - pos);\n";
+		os << "\t*end_out = i;\n"
+			"\treturn kind;\n"
+			"}\n\n";
+	}else
+	{
+		os << "\tsize_t end = pos + 1;\n"
+			"\tsize_t i;\n"
+			"\tsize_t s = " << start_code(info) << ";\n"
+			"\tint kind = REC_UNMATCHED;\n"
+			"\tfor(i = pos; i < len; i++)\n\t{\n"
+			"\t\tsize_t t = rec_transitions[s][buf[i]];\n"
+			"\t\tif(" << dead << ") break;\n"
+			"\t\ts = t;\n"
+			<< skip_code(info, "\t\t") <<
+			"\t\tif(" << branch(info, info.profile ? info.profile->accept_hits : 0, entered, "rec_accept[s] >= 0") << ")\n\t\t{\n"
+			"\t\t\tkind = rec_accept[s];\n"
+			"\t\t\tend = i + 1;\n"
+			"\t\t}\n"
+			"\t}\n"
+			"\tREC_STAT(if(i > end && !rec_stats_counters.paused) { rec_stats_counters.backtracks++; rec_stats_counters.backtrack_bytes += i - end; });\n";
+		os << simulated_code(info, "end");
+		os << trail_code(info, "end");
+		if(info.keyword_split) os << "\tif(rec_keyword_hosts[kind]) kind = rec_keyword(kind, buf + pos, end - pos);\n";
+		os << "\t*end_out = end;\n"
+			"\treturn kind;\n"
+			"}\n\n";
+		emit_memo(os, info);
+	}
+	os << "/* scans the longest token at the current position, skipping ignored tokens,\n"
+		"   returns its kind, REC_EOF at the end of input, or REC_UNMATCHED for a byte\n"
+		"   that starts no token */\n";
+	os << "static inline int rec_next(rec_lexer* lx, rec_token* tk)\n{\n"
+		"\tconst unsigned char* buf = lx->buf;\n"
+		"\tsize_t len = lx->len;\n"
+		"\tfor(;;)\n\t{\n"
+		"\t\tsize_t pos = lx->pos;\n"
+		"\t\tsize_t end;\n"
+		"\t\tint kind;\n"
+		"\t\tif(pos >= len)\n\t\t{\n"
+		"\t\t\ttk->kind = REC_EOF;\n"
+		"\t\t\ttk->start = pos;\n"
+		"\t\t\ttk->length = 0;\n"
+		"\t\t\treturn REC_EOF;\n"
+		"\t\t}\n"
+		"\t\tREC_STAT(rec_stats_counters.clock = REC_STATS_CLOCK());\n"
+		"\t\tkind = " << match << ";\n"
+		"\t\tREC_STAT(rec_stats_token(kind, end - pos));\n"
+		"\t\tlx->pos = end;\n"
+		<< begin <<
+		"\t\tif(rec_token_modes[kind] == REC_MODE_ERROR) REC_ON_ERROR(kind, pos, end - pos);\n"
+		"\t\tif(rec_token_modes[kind] == REC_MODE_IGNORE) continue;\n"
+		"\t\ttk->kind = kind;\n"
+		"\t\ttk->start = pos;\n"
+		"\t\ttk->length = end - pos;\n"
+		"\t\treturn kind;\n"
+		"\t}\n"
+		"}\n\n";
+	os << "/* scans up to max tokens into the caller's arrays, skipping ignored tokens, and\n"
+		"   returns how many were stored, the last one stored is REC_EOF once the input is\n"
+		"   exhausted */\n";
+	os << "static inline size_t rec_next_batch(rec_lexer* lx, rec_kind* kinds, size_t* starts, size_t* lengths, size_t max)\n{\n"
+		"\tconst unsigned char* buf = lx->buf;\n"
+		"\tsize_t len = lx->len;\n"
+		"\tsize_t pos = lx->pos;\n"
+		"\tsize_t n = 0;\n"
+		"\twhile(n < max)\n\t{\n"
+		"\t\tsize_t end;\n"
+		"\t\tint kind;\n"
+		"\t\tif(pos >= len)\n\t\t{\n"
+		"\t\t\tkinds[n] = REC_EOF;\n"
+		"\t\t\tstarts[n] = pos;\n"
+		"\t\t\tlengths[n] = 0;\n"
+		"\t\t\tn++;\n"
+		"\t\t\tbreak;\n"
+		"\t\t}\n"
+		"\t\tREC_STAT(rec_stats_counters.clock = REC_STATS_CLOCK());\n"
+		"\t\tkind = " << match << ";\n"
+		"\t\tREC_STAT(rec_stats_token(kind, end - pos));\n"
+		<< begin <<
+		"\t\tif(rec_token_modes[kind] == REC_MODE_ERROR) REC_ON_ERROR(kind, pos, end - pos);\n"
+		"\t\tif(rec_token_modes[kind] != REC_MODE_IGNORE)\n\t\t{\n"
+		"\t\t\tkinds[n] = (rec_kind)kind;\n"
+		"\t\t\tstarts[n] = pos;\n"
+		"\t\t\tlengths[n] = end - pos;\n"
+		"\t\t\tn++;\n"
+		"\t\t}\n"
+		"\t\tpos = end;\n"
+		"\t}\n"
+		"\tlx->pos = pos;\n"
+		"\treturn n;\n"
+		"}\n\n";
+}
+
+//line and column aren't tracked while lexing, the scan loop only deals in offsets and the
+//position of an offset is found when it's asked for by counting the newlines before it, 16
+//bytes per compare with sse2, either from the previous offset asked for or from the nearest
+//checkpoint of an index built in one pass over the buffer
+static void emit_lines(std::ostream& os, const lexer_info&)
+{
+	os << "/* line and column are computed from token offsets on demand, rec_next doesn't count them */\n";
+	os << "#ifdef __SSE2__\n#include <emmintrin.h>\n#endif\n\n";
+	os << "static inline unsigned int rec_popcount16(unsigned int m)\n{\n"
+		"#if defined(__GNUC__) || defined(__clang__)\n"
+		"\treturn (unsigned int)__builtin_popcount(m);\n"
+		"#else\n"
+		"\tm = m - ((m >> 1) & 0x5555u);\n"
+		"\tm = (m & 0x3333u) + ((m >> 2) & 0x3333u);\n"
+		"\tm = (m + (m >> 4)) & 0x0f0fu;\n"
+		"\treturn (m + (m >> 8)) & 0x1fu;\n"
+		"#endif\n"
+		"}\n\n";
+	os << "/* number of newlines in buf[from, to) */\n";
+	os << "static inline uint64_t rec_count_newlines(const unsigned char* buf, size_t from, size_t to)\n{\n"
+		"\tuint64_t n = 0;\n"
+		"\tsize_t i = from;\n"
+		"#ifdef __SSE2__\n"
+		"\tconst __m128i nl = _mm_set1_epi8('\\n');\n"
+		"\tfor(; i + 16 <= to; i += 16)\n\t{\n"
+		"\t\t__m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(buf + i)), nl);\n"
+		"\t\tn += rec_popcount16((unsigned int)_mm_movemask_epi8(eq));\n"
+		"\t}\n"
+		"#endif\n"
+		"\tfor(; i < to; i++) n += buf[i] == '\\n';\n"
+		"\treturn n;\n"
+		"}\n\n";
+	os << "/* one past the last newline in buf[from, to), from if there is none */\n";
+	os << "static inline size_t rec_line_start(const unsigned char* buf, size_t from, size_t to)\n{\n"
+		"\twhile(to > from && buf[to - 1] != '\\n') to--;\n"
+		"\treturn to;\n"
+		"}\n\n";
+	os << "/* position of offsets visited in increasing order, like the starts of the tokens rec_next\n"
+		"   returns, every step only counts the newlines since the previous offset */\n";
+	os << "typedef struct rec_position\n{\n"
+		"\tsize_t offset;\n"
+		"\tuint64_t line; /* line of offset, from 1 */\n"
+		"\tsize_t line_start; /* offset that line starts at */\n"
+		"} rec_position;\n\n";
+	os << "static inline void rec_position_init(rec_position* p)\n{\n"
+		"\tp->offset = 0;\n"
+		"\tp->line = 1;\n"
+		"\tp->line_start = 0;\n"
+		"}\n\n";
+	os << "/* moves p forward to offset, which can't be before p->offset, and returns its column\n"
+		"   (from 1, in bytes), its line is p->line */\n";
+	os << "static inline uint64_t rec_position_advance(rec_position* p, const char* buf, size_t offset)\n{\n"
+		"\tconst unsigned char* b = (const unsigned char*)buf;\n"
+		"\tuint64_t n = rec_count_newlines(b, p->offset, offset);\n"
+		"\tif(n)\n\t{\n"
+		"\t\tp->line += n;\n"
+		"\t\tp->line_start = rec_line_start(b, p->offset, offset);\n"
+		"\t}\n"
+		"\tp->offset = offset;\n"
+		"\treturn (uint64_t)(offset - p->line_start) + 1;\n"
+		"}\n\n";
+	os << "/* random access to positions, checkpoint k holds the position of byte k * REC_LINE_STRIDE\n"
+		"   so a lookup counts at most REC_LINE_STRIDE bytes */\n";
+	os << "#define REC_LINE_STRIDE 4096u\n";
+	os << "#define REC_LINE_CHECKPOINTS(len) ((size_t)(len) / REC_LINE_STRIDE + 1)\n\n";
+	os << "typedef struct rec_line_checkpoint\n{\n"
+		"\tuint64_t line;\n"
+		"\tsize_t line_start;\n"
+		"} rec_line_checkpoint;\n\n";
+	os << "typedef struct rec_line_index\n{\n"
+		"\tconst char* buf;\n"
+		"\tsize_t len;\n"
+		"\trec_line_checkpoint* checkpoints; /* caller provided, REC_LINE_CHECKPOINTS(len) of them */\n"
+		"} rec_line_index;\n\n";
+	os << "static inline void rec_line_index_init(rec_line_index* idx, const char* buf, size_t len, rec_line_checkpoint* checkpoints)\n{\n"
+		"\trec_position p;\n"
+		"\tsize_t k;\n"
+		"\tidx->buf = buf;\n"
+		"\tidx->len = len;\n"
+		"\tidx->checkpoints = checkpoints;\n"
+		"\trec_position_init(&p);\n"
+		"\tfor(k = 0; k < REC_LINE_CHECKPOINTS(len); k++)\n\t{\n"
+		"\t\trec_position_advance(&p, buf, k * REC_LINE_STRIDE);\n"
+		"\t\tcheckpoints[k].line = p.line;\n"
+		"\t\tcheckpoints[k].line_start = p.line_start;\n"
+		"\t}\n"
+		"}\n\n";
+	os << "/* stores the line and column (from 1) of offset, at most idx->len */\n";
+	os << "static inline void rec_line_lookup(const rec_line_index* idx, size_t offset, uint64_t* line, uint64_t* column)\n{\n"
+		"\tconst rec_line_checkpoint* c = &idx->checkpoints[offset / REC_LINE_STRIDE];\n"
+		"\trec_position p;\n"
+		"\tp.offset = offset / REC_LINE_STRIDE * REC_LINE_STRIDE;\n"
+		"\tp.line = c->line;\n"
+		"\tp.line_start = c->line_start;\n"
+		"\t*column = rec_position_advance(&p, idx->buf, offset);\n"
+		"\t*line = p.line;\n"
+		"}\n\n";
+}
+
+//how far the scan for a token read, what incremental relexing and push lexing need to know
+//about a token to tell whether other input could have changed it
+static void emit_reach(std::ostream& os, const lexer_info& info)
+{
+	os << "/* one past the last byte the scan for the token [pos, end) read, end of input counts\n"
+		"   as a byte, an overestimate only costs extra relexing */\n";
+	os << "static inline size_t rec_reach(const unsigned char* buf, size_t len, size_t pos, size_t end" << condition_param(info) << ")\n{\n";
+	if(info.backtrack_free && !info.bit_parallel && !info.nfa_fallback && !info.trailing_context)
+	{
+		//the scan stops on the byte that ends the token, unless the token is an unmatched
+		//byte whose scan ran into the end of input, those are scanned again
+		os << "\tsize_t i;\n"
+			"\tsize_t s = " << start_code(info) << ";\n"
+			"\tif(end != pos + 1) return end + 1;\n"
+			"\tfor(i = pos; i < len; i++)\n\t{\n"
+			"\t\ts = rec_transitions[s][buf[i]];\n"
+			"\t\tif(s == REC_DEAD_STATE) break;\n"
+			"\t}\n"
+			"\treturn i + 1;\n"
+			"}\n\n";
+	}else
+	{
+		os << "\tsize_t i;\n"
+			"\tsize_t reach;\n"
+			"\tsize_t s = " << start_code(info) << ";\n";
+		if(info.bit_parallel || info.nfa_fallback) os << "\tsize_t r;\n";
+		os << "\t(void)end;\n"
+			"\tfor(i = pos; i < len; i++)\n\t{\n"
+			"\t\ts = rec_transitions[s][buf[i]];\n"
+			"\t\tif(s == REC_DEAD_STATE) break;\n"
+			"\t}\n"
+			"\treach = i + 1;\n";
+		if(info.bit_parallel)
+		{
+			os << "\tfor(r = 0; r < REC_BIT_PARALLEL_COUNT; r++)\n\t{\n"
+				"\t\tconst rec_bit_parallel* bp = &rec_bit_parallel_rules[r];\n"
+				"\t\tuint64_t next = bp->first;\n"
+				"\t\tsize_t k;\n"
+				<< condition_skip(info, "bp->kind") <<
+				"\t\tfor(i = pos; i < len; i++)\n\t\t{\n"
+				"\t\t\tuint64_t d = next & bp->bytes[buf[i]];\n"
+				"\t\t\tif(!d) break;\n"
+				"\t\t\tnext = 0;\n"
+				"\t\t\tfor(k = 0; k < bp->chunks; k++) next |= bp->follow[k][(d >> (8 * k)) & 0xff];\n"
+				"\t\t}\n"
+				"\t\tif(i + 1 > reach) reach = i + 1;\n"
+				"\t}\n";
+		}
+		if(info.nfa_fallback)
+		{
+			os << "\tfor(r = 0; r < REC_NFA_COUNT; r++)\n\t{\n"
+				"\t\tsize_t nfa_reach;\n"
+				<< condition_skip(info, "rec_nfa_rules[r].kind") <<
+				"\t\trec_nfa_match(&rec_nfa_rules[r], buf, len, pos, &nfa_reach);\n"
+				"\t\tif(nfa_reach > reach) reach = nfa_reach;\n"
+				"\t}\n";
+		}
+		os << "\treturn reach;\n"
+			"}\n\n";
+	}
+}
+
+//incremental relexing, a token only depends on the bytes its scan read so the stream keeps
+//how far the scans got (running maximum) and an edit only relexes tokens whose scans read
+//into it, lexing from a token boundary is deterministic so once a new token starts where an
+//old one after the edit started (shifted by the edit) the rest of the old stream still holds
+static void emit_incremental(std::ostream& os, const lexer_info&)
+{
+	os << "/* a token stream kept up to date under edits, the tokens rec_next returns followed by\n"
+		"   REC_EOF, reaches[i] is the furthest any scan up to token i read (see rec_reach) */\n";
+	os << "typedef struct rec_stream\n{\n"
+		"\trec_kind* kinds;\n"
+		"\tsize_t* starts;\n"
+		"\tsize_t* lengths;\n"
+		"\tsize_t* reaches;\n"
+		"\tsize_t capacity;\n"
+		"\tsize_t count;\n"
+		"\tsize_t relexed; /* tokens the last rec_stream_edit lexed before resynchronizing */\n"
+		"} rec_stream;\n\n";
+	os << "static inline void rec_stream_move(rec_stream* st, size_t to, size_t from, size_t n)\n{\n"
+		"\tmemmove(st->kinds + to, st->kinds + from, n * sizeof(*st->kinds));\n"
+		"\tmemmove(st->starts + to, st->starts + from, n * sizeof(*st->starts));\n"
+		"\tmemmove(st->lengths + to, st->lengths + from, n * sizeof(*st->lengths));\n"
+		"\tmemmove(st->reaches + to, st->reaches + from, n * sizeof(*st->reaches));\n"
+		"}\n\n";
+	os << "/* lexes buf from pos, storing tokens from index w on, until the input ends or a boundary\n"
+		"   lines up with the token at index q or later shifted by delta (old_end to new_end),\n"
+		"   returns the index the lined up token is at or st->capacity, w is updated */\n";
+	os << "static inline size_t rec_stream_scan(rec_stream* st, const unsigned char* buf, size_t len, size_t pos, size_t* w, size_t q, size_t old_end, size_t new_end)\n{\n"
+		"\tsize_t reach = *w ? st->reaches[*w - 1] : 0;\n"
+		"\tfor(;;)\n\t{\n"
+		"\t\tsize_t end;\n"
+		"\t\tsize_t r;\n"
+		"\t\tint kind;\n"
+		"\t\twhile(q < st->capacity && st->starts[q] - old_end + new_end < pos) q++;\n"
+		"\t\tif(q < st->capacity && st->starts[q] - old_end + new_end == pos) return q;\n"
+		"\t\tif(*w >= q) return st->capacity + 1;\n"
+		"\t\tif(pos >= len)\n\t\t{\n"
+		"\t\t\tst->kinds[*w] = REC_EOF;\n"
+		"\t\t\tst->starts[*w] = pos;\n"
+		"\t\t\tst->lengths[*w] = 0;\n"
+		"\t\t\tst->reaches[*w] = reach > len + 1 ? reach : len + 1;\n"
+		"\t\t\t(*w)++;\n"
+		"\t\t\treturn st->capacity;\n"
+		"\t\t}\n"
+		"\t\tREC_STAT(rec_stats_counters.clock = REC_STATS_CLOCK());\n"
+		"\t\tkind = rec_match(buf, len, pos, &end);\n"
+		"\t\tREC_STAT(rec_stats_token(kind, end - pos));\n"
+		"\t\tr = rec_reach(buf, len, pos, end);\n"
+		"\t\tif(r > reach) reach = r;\n"
+		"\t\tif(rec_token_modes[kind] != REC_MODE_IGNORE)\n\t\t{\n"
+		"\t\t\tst->kinds[*w] = (rec_kind)kind;\n"
+		"\t\t\tst->starts[*w] = pos;\n"
+		"\t\t\tst->lengths[*w] = end - pos;\n"
+		"\t\t\tst->reaches[*w] = reach;\n"
+		"\t\t\t(*w)++;\n"
+		"\t\t}\n"
+		"\t\tpos = end;\n"
+		"\t}\n"
+		"}\n\n";
+	os << "/* lexes the whole buffer into the stream, returns 0 if the capacity ran out */\n";
+	os << "static inline int rec_stream_lex(rec_stream* st, const char* buf, size_t len)\n{\n"
+		"\tsize_t w = 0;\n"
+		"\tsize_t q = rec_stream_scan(st, (const unsigned char*)buf, len, 0, &w, st->capacity, 0, 0);\n"
+		"\tst->count = w;\n"
+		"\tst->relexed = w;\n"
+		"\treturn q == st->capacity;\n"
+		"}\n\n";
+	os << "/* updates the stream after the bytes [edit_start, old_end) of the previous buffer were\n"
+		"   replaced by the bytes [edit_start, new_end) of buf, only the tokens whose scans read into\n"
+		"   the edit are lexed again, up to where the new tokens line up with the old ones, returns\n"
+		"   0 if the capacity ran out, the stream then has to be lexed again with rec_stream_lex */\n";
+	os << "static inline int rec_stream_edit(rec_stream* st, const char* buf, size_t len, size_t edit_start, size_t old_end, size_t new_end)\n{\n"
+		"\tsize_t lo = 0;\n"
+		"\tsize_t hi = st->count;\n"
+		"\tsize_t first;\n"
+		"\tsize_t w;\n"
+		"\tsize_t q;\n"
+		"\tsize_t i;\n"
+		"\tsize_t tail;\n"
+		"\tsize_t reach;\n"
+		"\t/* the first token whose scans read into the edit, the stream ends in REC_EOF which\n"
+		"\t   read past the end so there always is one */\n"
+		"\twhile(lo < hi)\n\t{\n"
+		"\t\tsize_t mid = lo + (hi - lo) / 2;\n"
+		"\t\tif(st->reaches[mid] <= edit_start) lo = mid + 1;\n"
+		"\t\telse hi = mid;\n"
+		"\t}\n"
+		"\tfirst = w = lo;\n"
+		"\t/* park the tokens starting after the edit at the back, at least REC_EOF */\n"
+		"\thi = st->count;\n"
+		"\twhile(lo < hi)\n\t{\n"
+		"\t\tsize_t mid = lo + (hi - lo) / 2;\n"
+		"\t\tif(st->starts[mid] < old_end) lo = mid + 1;\n"
+		"\t\telse hi = mid;\n"
+		"\t}\n"
+		"\ttail = st->count - lo;\n"
+		"\trec_stream_move(st, st->capacity - tail, lo, tail);\n"
+		"\tq = rec_stream_scan(st, (const unsigned char*)buf, len, w ? st->starts[w - 1] + st->lengths[w - 1] : 0,\n"
+		"\t\t&w, st->capacity - tail, old_end, new_end);\n"
+		"\tif(q >= st->capacity) return 0;\n"
+		"\tst->relexed = w - first;\n"
+		"\t/* the old tokens from q on are still right once shifted by the edit, their reaches\n"
+		"\t   may still count scans that were relexed which only overestimates them */\n"
+		"\treach = w ? st->reaches[w - 1] : 0;\n"
+		"\ttail = st->capacity - q;\n"
+		"\trec_stream_move(st, w, q, tail);\n"
+		"\tfor(i = w; i < w + tail; i++)\n\t{\n"
+		"\t\tst->starts[i] = st->starts[i] - old_end + new_end;\n"
+		"\t\tst->reaches[i] = st->reaches[i] - old_end + new_end;\n"
+		"\t\tif(st->reaches[i] < reach) st->reaches[i] = reach;\n"
+		"\t\treach = st->reaches[i];\n"
+		"\t}\n"
+		"\tst->count = w + tail;\n"
+		"\treturn 1;\n"
+		"}\n\n";
+}
+
+//push lexing for input that arrives in pieces, the bytes that aren't part of a finished token
+//yet are kept and rescanned when more arrive, a token is finished once its scan died inside
+//them (rec_reach), so the lexer's whole state is those bytes and where they are in the input,
+//which is what a snapshot stores, the dfa state isn't saved and a snapshot stays valid for a
+//regenerated lexer
+static void emit_push(std::ostream& os, const lexer_info& info)
+{
+	const bool conditions = !info.conditions.empty();
+	os << "/* called for every finished token that isn't in ignore mode, offset is its position in\n"
+		"   the whole input, line and column (from 1) are those of its first byte */\n";
+	os << "typedef void (*rec_push_callback)(void* ctx, int kind, const unsigned char* lexeme, size_t length,\n"
+		"\tuint64_t offset, uint64_t line, uint64_t column);\n\n";
+	os << "typedef struct rec_push\n{\n"
+		"\tunsigned char* pending; /* caller provided, input not yet part of a finished token */\n"
+		"\tsize_t capacity; /* bounds the longest token (plus the bytes scanned past it) */\n"
+		"\tsize_t count;\n"
+		"\tuint64_t offset; /* input offset of pending[0] */\n"
+		"\tuint64_t line; /* line and column of pending[0] */\n"
+		"\tuint64_t column;\n"
+		<< (conditions ? "\tint cond; /* start condition the pending input is matched in */\n" : "") <<
+		"} rec_push;\n\n";
+	os << "static inline void rec_push_init(rec_push* p, unsigned char* pending, size_t capacity)\n{\n"
+		"\tp->pending = pending;\n"
+		"\tp->capacity = capacity;\n"
+		"\tp->count = 0;\n"
+		"\tp->offset = 0;\n"
+		"\tp->line = 1;\n"
+		"\tp->column = 1;\n"
+		<< (conditions ? "\tp->cond = REC_COND_INITIAL;\n" : "") <<
+		"}\n\n";
+	os << "/* emits the pending tokens that are finished, all of them at the end of input */\n";
+	os << "static inline void rec_push_drain(rec_push* p, rec_push_callback emit, void* ctx, int final)\n{\n"
+		"\tsize_t pos = 0;\n"
+		"\tuint64_t line = p->line;\n"
+		"\tuint64_t column = p->column;\n"
+		"\twhile(pos < p->count)\n\t{\n"
+		"\t\tsize_t end;\n"
+		"\t\tuint64_t n;\n"
+		"\t\tint kind;\n"
+		"\t\tREC_STAT(rec_stats_counters.clock = REC_STATS_CLOCK());\n"
+		"\t\tkind = rec_match(p->pending, p->count, pos, &end" << (conditions ? ", p->cond" : "") << ");\n"
+		"\t\tif(!final && rec_reach(p->pending, p->count, pos, end" << (conditions ? ", p->cond" : "") << ") > p->count) break;\n"
+		"\t\tREC_STAT(rec_stats_token(kind, end - pos));\n"
+		<< (conditions ? "\t\tif(rec_token_begin[kind] >= 0) p->cond = rec_token_begin[kind];\n" : "") <<
+		"\t\tif(rec_token_modes[kind] == REC_MODE_ERROR) REC_ON_ERROR(kind, p->offset + pos, end - pos);\n"
+		"\t\tif(rec_token_modes[kind] != REC_MODE_IGNORE) emit(ctx, kind, p->pending + pos, end - pos, p->offset + pos, line, column);\n"
+		"\t\tn = rec_count_newlines(p->pending, pos, end);\n"
+		"\t\tif(n)\n\t\t{\n"
+		"\t\t\tline += n;\n"
+		"\t\t\tcolumn = (uint64_t)(end - rec_line_start(p->pending, pos, end)) + 1;\n"
+		"\t\t}else\n\t\t{\n"
+		"\t\t\tcolumn += end - pos;\n"
+		"\t\t}\n"
+		"\t\tpos = end;\n"
+		"\t}\n"
+		"\tmemmove(p->pending, p->pending + pos, p->count - pos);\n"
+		"\tp->count -= pos;\n"
+		"\tp->offset += pos;\n"
+		"\tp->line = line;\n"
+		"\tp->column = column;\n"
+		"}\n\n";
+	os << "/* lexes the next n bytes of input, returns how many were consumed, fewer than n only if\n"
+		"   a token doesn't fit in the pending buffer */\n";
+	os << "static inline size_t rec_push_feed(rec_push* p, const char* data, size_t n, rec_push_callback emit, void* ctx)\n{\n"
+		"\tsize_t used = 0;\n"
+		"\twhile(used < n)\n\t{\n"
+		"\t\tsize_t take = p->capacity - p->count;\n"
+		"\t\tif(take == 0) break;\n"
+		"\t\tif(take > n - used) take = n - used;\n"
+		"\t\tmemcpy(p->pending + p->count, data + used, take);\n"
+		"\t\tp->count += take;\n"
+		"\t\tused += take;\n"
+		"\t\trec_push_drain(p, emit, ctx, 0);\n"
+		"\t}\n"
+		"\treturn used;\n"
+		"}\n\n";
+	os << "/* the input ended, emits the remaining tokens */\n";
+	os << "static inline void rec_push_finish(rec_push* p, rec_push_callback emit, void* ctx)\n{\n"
+		"\trec_push_drain(p, emit, ctx, 1);\n"
+		"}\n\n";
+	if(conditions)
+	{
+		os << "/* a snapshot is a 4 byte tag, offset, line, column, the pending byte count and the start\n"
+			"   condition as 64 bit little endian numbers, then the pending bytes, lexing resumes by\n"
+			"   restoring it and feeding the input from offset + count */\n";
+		os << "#define REC_SNAPSHOT_HEADER 44u\n";
+	}else
+	{
+		os << "/* a snapshot is a 4 byte tag, offset, line, column and the pending byte count as 64 bit\n"
+			"   little endian numbers, then the pending bytes, lexing resumes by restoring it and\n"
+			"   feeding the input from offset + count */\n";
+		os << "#define REC_SNAPSHOT_HEADER 36u\n";
+	}
+	//the tag tells the layouts apart
+	const char* tag = conditions ? "\"rec\\002\"" : "\"rec\\001\"";
+	os << "#define REC_SNAPSHOT_SIZE(p) (REC_SNAPSHOT_HEADER + (p)->count)\n\n";
+	os << "static inline void rec_put64(unsigned char* out, uint64_t v)\n{\n"
+		"\tint i;\n"
+		"\tfor(i = 0; i < 8; i++) out[i] = (unsigned char)(v >> (8 * i));\n"
+		"}\n\n";
+	os << "static inline uint64_t rec_get64(const unsigned char* in)\n{\n"
+		"\tuint64_t v = 0;\n"
+		"\tint i;\n"
+		"\tfor(i = 7; i >= 0; i--) v = (v << 8) | in[i];\n"
+		"\treturn v;\n"
+		"}\n\n";
+	os << "/* writes REC_SNAPSHOT_SIZE(p) bytes to out and returns that size */\n";
+	os << "static inline size_t rec_push_snapshot(const rec_push* p, unsigned char* out)\n{\n"
+		"\tmemcpy(out, " << tag << ", 4);\n"
+		"\trec_put64(out + 4, p->offset);\n"
+		"\trec_put64(out + 12, p->line);\n"
+		"\trec_put64(out + 20, p->column);\n"
+		"\trec_put64(out + 28, (uint64_t)p->count);\n"
+		<< (conditions ? "\trec_put64(out + 36, (uint64_t)p->cond);\n" : "") <<
+		"\tmemcpy(out + REC_SNAPSHOT_HEADER, p->pending, p->count);\n"
+		"\treturn REC_SNAPSHOT_SIZE(p);\n"
+		"}\n\n";
+	os << "/* restores a snapshot into a lexer set up with rec_push_init, returns 0 if the snapshot\n"
+		"   is malformed or its pending bytes don't fit */\n";
+	os << "static inline int rec_push_restore(rec_push* p, const unsigned char* in, size_t size)\n{\n"
+		"\tuint64_t count;\n"
+		"\tif(size < REC_SNAPSHOT_HEADER || memcmp(in, " << tag << ", 4) != 0) return 0;\n"
+		"\tcount = rec_get64(in + 28);\n"
+		"\tif(count > p->capacity || count != size - REC_SNAPSHOT_HEADER) return 0;\n"
+		<< (conditions ? "\tif(rec_get64(in + 36) >= REC_COND_COUNT) return 0;\n" : "") <<
+		"\tp->offset = rec_get64(in + 4);\n"
+		"\tp->line = rec_get64(in + 12);\n"
+		"\tp->column = rec_get64(in + 20);\n"
+		"\tp->count = (size_t)count;\n"
+		<< (conditions ? "\tp->cond = (int)rec_get64(in + 36);\n" : "") <<
+		"\tmemcpy(p->pending, in + REC_SNAPSHOT_HEADER, p->count);\n"
+		"\treturn 1;\n"
+		"}\n\n";
+}
+
+//speculative parallel lexing, every chunk is lexed from the start state as if a token began
+//at its first byte, maximal munch from a token boundary doesn't depend on what came before so
+//a chunk's tokens are exact from the first one starting where its predecessor's tokens end
+static void emit_parallel(std::ostream& os, const lexer_info& info)
+{
+	os << "/* a slice of the input lexed on its own, possibly on another thread, the tokens\n"
+		"   starting in [begin, end) are stored, the last one may extend past end */\n";
+	os << "typedef struct rec_chunk\n{\n"
+		"\tsize_t begin;\n"
+		"\tsize_t end;\n"
+		"\tsize_t capacity; /* length of the arrays, at least end - begin */\n"
+		"\trec_kind* kinds;\n"
+		"\tsize_t* starts;\n"
+		"\tsize_t* lengths;\n"
+		"\tsize_t first; /* first token agreeing with the previous chunk */\n"
+		"\tsize_t count;\n"
+		"\tsize_t relexed; /* tokens rec_reconcile had to lex again before resynchronizing */\n";
+	if(info.composed)
+	{
+		os << "\tsize_t state; /* rec_lex_composed: lexer state at begin */\n"
+			"\tunsigned char map[16]; /* rec_lex_composed: state after the chunk for each state before it */\n";
+	}
+	os << "} rec_chunk;\n\n";
+	os << "static inline void rec_chunk_move(rec_chunk* c, size_t to, size_t from, size_t n)\n{\n"
+		"\tmemmove(c->kinds + to, c->kinds + from, n * sizeof(*c->kinds));\n"
+		"\tmemmove(c->starts + to, c->starts + from, n * sizeof(*c->starts));\n"
+		"\tmemmove(c->lengths + to, c->lengths + from, n * sizeof(*c->lengths));\n"
+		"}\n\n";
+	os << "/* lexes a chunk speculatively from its first byte, ignored tokens are kept until\n"
+		"   rec_compact_chunk since they are resynchronization points */\n";
+	os << "static inline void rec_lex_chunk(const char* buf, size_t len, rec_chunk* c)\n{\n"
+		"\tconst unsigned char* ubuf = (const unsigned char*)buf;\n"
+		"\tsize_t pos = c->begin;\n"
+		"\tsize_t n = 0;\n"
+		"\twhile(pos < c->end)\n\t{\n"
+		"\t\tsize_t end;\n"
+		"\t\tint kind = rec_match(ubuf, len, pos, &end);\n"
+		"\t\tc->kinds[n] = (rec_kind)kind;\n"
+		"\t\tc->starts[n] = pos;\n"
+		"\t\tc->lengths[n] = end - pos;\n"
+		"\t\tn++;\n"
+		"\t\tpos = end;\n"
+		"\t}\n"
+		"\tc->first = 0;\n"
+		"\tc->count = n;\n"
+		"\tc->relexed = 0;\n"
+		"}\n\n";
+	os << "/* walks the chunks in order, each one is valid from the token starting where the\n"
+		"   previous chunk's last token ends, if no speculative token starts there the chunk\n"
+		"   is lexed again from that point until a token boundary lines up */\n";
+	os << "static inline void rec_reconcile(const char* buf, size_t len, rec_chunk* chunks, size_t n)\n{\n"
+		"\tconst unsigned char* ubuf = (const unsigned char*)buf;\n"
+		"\tsize_t p;\n"
+		"\tsize_t k;\n"
+		"\tif(n == 0) return;\n"
+		"\tp = chunks[0].count ? chunks[0].starts[chunks[0].count - 1] + chunks[0].lengths[chunks[0].count - 1] : chunks[0].begin;\n"
+		"\tfor(k = 1; k < n; k++)\n\t{\n"
+		"\t\trec_chunk* c = &chunks[k];\n"
+		"\t\tsize_t lo = 0;\n"
+		"\t\tsize_t hi = c->count;\n"
+		"\t\tif(p >= c->end)\n\t\t{\n"
+		"\t\t\tc->first = c->count = 0;\n"
+		"\t\t\tcontinue;\n"
+		"\t\t}\n"
+		"\t\twhile(lo < hi)\n\t\t{\n"
+		"\t\t\tsize_t mid = lo + (hi - lo) / 2;\n"
+		"\t\t\tif(c->starts[mid] < p) lo = mid + 1;\n"
+		"\t\t\telse hi = mid;\n"
+		"\t\t}\n"
+		"\t\tif(lo < c->count && c->starts[lo] == p)\n\t\t{\n"
+		"\t\t\tc->first = lo;\n"
+		"\t\t}else\n\t\t{\n"
+		"\t\t\t/* park the speculative tokens at the back, relexed ones never catch up with\n"
+		"\t\t\t   them since every token starts on a distinct byte of the chunk */\n"
+		"\t\t\tsize_t off = c->capacity - c->count;\n"
+		"\t\t\tsize_t j = off + lo;\n"
+		"\t\t\tsize_t w = 0;\n"
+		"\t\t\tsize_t pos = p;\n"
+		"\t\t\trec_chunk_move(c, off, 0, c->count);\n"
+		"\t\t\twhile(pos < c->end)\n\t\t\t{\n"
+		"\t\t\t\tsize_t end;\n"
+		"\t\t\t\tint kind;\n"
+		"\t\t\t\twhile(j < c->capacity && c->starts[j] < pos) j++;\n"
+		"\t\t\t\tif(j < c->capacity && c->starts[j] == pos) break;\n"
+		"\t\t\t\tkind = rec_match(ubuf, len, pos, &end);\n"
+		"\t\t\t\tc->kinds[w] = (rec_kind)kind;\n"
+		"\t\t\t\tc->starts[w] = pos;\n"
+		"\t\t\t\tc->lengths[w] = end - pos;\n"
+		"\t\t\t\tw++;\n"
+		"\t\t\t\tpos = end;\n"
+		"\t\t\t}\n"
+		"\t\t\tif(pos >= c->end) j = c->capacity;\n"
+		"\t\t\trec_chunk_move(c, w, j, c->capacity - j);\n"
+		"\t\t\tc->first = 0;\n"
+		"\t\t\tc->count = w + c->capacity - j;\n"
+		"\t\t\tc->relexed = w;\n"
+		"\t\t}\n"
+		"\t\tif(c->count > c->first) p = c->starts[c->count - 1] + c->lengths[c->count - 1];\n"
+		"\t}\n"
+		"}\n\n";
+	os << "/* moves a reconciled chunk's tokens to the front of its arrays, dropping ignored ones */\n";
+	os << "static inline void rec_compact_chunk(rec_chunk* c)\n{\n"
+		"\tsize_t i;\n"
+		"\tsize_t n = 0;\n"
+		"\tfor(i = c->first; i < c->count; i++)\n\t{\n"
+		"\t\tif(rec_token_modes[c->kinds[i]] == REC_MODE_IGNORE) continue;\n"
+		"\t\tc->kinds[n] = c->kinds[i];\n"
+		"\t\tc->starts[n] = c->starts[i];\n"
+		"\t\tc->lengths[n] = c->lengths[i];\n"
+		"\t\tn++;\n"
+		"\t}\n"
+		"\tc->first = 0;\n"
+		"\tc->count = n;\n"
+		"}\n\n";
+	os << "/* lexes the chunks in parallel when compiled with openmp, sequentially otherwise,\n"
+		"   afterwards the chunks hold the same tokens rec_next would return, in order */\n";
+	os << "static inline void rec_lex_parallel(const char* buf, size_t len, rec_chunk* chunks, size_t n)\n{\n"
+		"\tlong i;\n"
+		"\tREC_STAT(rec_stats_counters.paused++);\n"
+		"#ifdef _OPENMP\n"
+		"#pragma omp parallel for schedule(dynamic, 1)\n"
+		"#endif\n"
+		"\tfor(i = 0; i < (long)n; i++) rec_lex_chunk(buf, len, &chunks[i]);\n"
+		"\trec_reconcile(buf, len, chunks, n);\n"
+		"#ifdef _OPENMP\n"
+		"#pragma omp parallel for schedule(dynamic, 1)\n"
+		"#endif\n"
+		"\tfor(i = 0; i < (long)n; i++) rec_compact_chunk(&chunks[i]);\n"
+		"\tREC_STAT(rec_stats_counters.paused--);\n"
+		"}\n\n";
+}
+
+//the lexer can run as a plain dfa over the input when it never backtracks, a state that dies
+//on a byte ends its token and the byte restarts from the start state, with at most 16 live
+//states the effect of a whole chunk is a 16 byte state map built with one shuffle per byte
+static bool composable(const Lexer_Dfa& dfa)
+{
+	const std::vector<Lexer_Dfa::state>& states = dfa;
+	if(states.size()-1 > 16 || !dfa.backtrack_free()) return false;
+	//the start state must only mean 'between tokens'
+	for(const Lexer_Dfa::state& s : states)
+	{
+		for(size_t t : s.transitions)
+		{
+			if(t == Lexer_Dfa::start_state) return false;
+		}
+	}
+	return true;
+}
+
+static void emit_composed(std::ostream& os, const lexer_info& info)
+{
+	const std::vector<Lexer_Dfa::state>& states = info.dfa;
+	os << "/* transition function composition, only emitted for lexers that never backtrack\n"
+		"   and have at most 16 live states, rec_compose[b][q] is the state after byte b from\n"
+		"   state q + 1 (minus one), a state that dies ends its token and restarts */\n";
+	os << "#define REC_COMPOSED 1\n\n";
+	os << "#ifdef __SSSE3__\n#include <tmmintrin.h>\n#endif\n\n";
+	os << "static const unsigned char rec_compose[256][16] =\n{\n";
+	for(unsigned int ch = 0; ch < 256; ch++)
+	{
+		os << "\t{";
+		for(size_t q = 0; q < 16; q++)
+		{
+			size_t t = Lexer_Dfa::start_state;
+			if(q+1 < states.size())
+			{
+				t = states[q+1].transitions[ch];
+				if(t == Lexer_Dfa::dead_state) t = states[Lexer_Dfa::start_state].transitions[ch];
+				if(t == Lexer_Dfa::dead_state) t = Lexer_Dfa::start_state; //unmatched byte
+			}
+			os << t-1 << (q < 15 ? "," : "");
+		}
+		os << "}" << (ch < 255 ? "," : "") << '\n';
+	}
+	os << "};\n\n";
+	os << "static inline void rec_composed_map(const unsigned char* buf, rec_chunk* c)\n{\n"
+		"\tsize_t i;\n"
+		"#ifdef __SSSE3__\n"
+		"\t__m128i v = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);\n"
+		"\tfor(i = c->begin; i < c->end; i++)\n"
+		"\t\tv = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)rec_compose[buf[i]]), v);\n"
+		"\t_mm_storeu_si128((__m128i*)c->map, v);\n"
+		"#else\n"
+		"\tsize_t q;\n"
+		"\tfor(q = 0; q < 16; q++) c->map[q] = (unsigned char)q;\n"
+		"\tfor(i = c->begin; i < c->end; i++)\n\t{\n"
+		"\t\tconst unsigned char* t = rec_compose[buf[i]];\n"
+		"\t\tfor(q = 0; q < 16; q++) c->map[q] = t[c->map[q]];\n"
+		"\t}\n"
+		"#endif\n"
+		"}\n\n";
+	os << "static inline void rec_composed_push(rec_chunk* c, const unsigned char* buf, int kind, size_t start, size_t end)\n{\n";
+	if(info.keyword_split) os << "\tif(rec_keyword_hosts[kind]) kind = rec_keyword(kind, buf + start, end - start);\n";
+	else os << "\t(void)buf;\n";
+	os << "\tif(rec_token_modes[kind] == REC_MODE_IGNORE) return;\n"
+		"\tc->kinds[c->count] = (rec_kind)kind;\n"
+		"\tc->starts[c->count] = start;\n"
+		"\tc->lengths[c->count] = end - start;\n"
+		"\tc->count++;\n"
+		"}\n\n";
+	os << "/* runs the chunk from its known entry state, a token is stored by the chunk it starts\n"
+		"   in, returns where lexing has to continue with rec_next if the input ends inside a\n"
+		"   token that needs backtracking, len otherwise */\n";
+	os << "static inline size_t rec_composed_tokens(const unsigned char* buf, size_t len, rec_chunk* c)\n{\n"
+		"\tsize_t s = c->state;\n"
+		"\tsize_t i = c->begin;\n"
+		"\tsize_t tok = c->begin;\n"
+		"\tint owned = s == REC_START_STATE;\n"
+		"\tc->first = c->count = c->relexed = 0;\n"
+		"\tfor(;;)\n\t{\n"
+		"\t\tsize_t t;\n"
+		"\t\tif(i >= len)\n\t\t{\n"
+		"\t\t\tif(!owned || s == REC_START_STATE) return len;\n"
+		"\t\t\tif(rec_accept[s] < 0) return tok;\n"
+		"\t\t\trec_composed_push(c, buf, rec_accept[s], tok, i);\n"
+		"\t\t\treturn len;\n"
+		"\t\t}\n"
+		"\t\tif(i >= c->end && (!owned || s == REC_START_STATE)) return len;\n"
+		"\t\tt = rec_transitions[s][buf[i]];\n"
+		"\t\tif(t != REC_DEAD_STATE)\n\t\t{\n"
+		"\t\t\ts = t;\n"
+		"\t\t\ti++;\n"
+		"\t\t\tcontinue;\n"
+		"\t\t}\n"
+		"\t\tif(s != REC_START_STATE && owned) rec_composed_push(c, buf, rec_accept[s], tok, i);\n"
+		"\t\towned = 1;\n"
+		"\t\ttok = i;\n"
+		"\t\ts = REC_START_STATE;\n"
+		"\t\tif(i >= c->end) return len;\n"
+		"\t\ts = rec_transitions[REC_START_STATE][buf[i]];\n"
+		"\t\tif(s == REC_DEAD_STATE)\n\t\t{\n"
+		"\t\t\trec_composed_push(c, buf, REC_UNMATCHED, i, i + 1);\n"
+		"\t\t\ts = REC_START_STATE;\n"
+		"\t\t\ttok = i + 1;\n"
+		"\t\t}\n"
+		"\t\ti++;\n"
+		"\t}\n"
+		"}\n\n";
+	os << "/* exact parallel lexing without resynchronization, every chunk's state map is built in\n"
+		"   parallel, composed in order to find each chunk's entry state, then every chunk is\n"
+		"   lexed in parallel from it, returns len or the position rec_next has to finish from */\n";
+	os << "static inline size_t rec_lex_composed(const char* buf, size_t len, rec_chunk* chunks, size_t n)\n{\n"
+		"\tconst unsigned char* ubuf = (const unsigned char*)buf;\n"
+		"\tsize_t tail = len;\n"
+		"\tsize_t s = 0;\n"
+		"\tlong i;\n"
+		"\tREC_STAT(rec_stats_counters.paused++);\n"
+		"#ifdef _OPENMP\n"
+		"#pragma omp parallel for schedule(dynamic, 1)\n"
+		"#endif\n"
+		"\tfor(i = 0; i < (long)n; i++) rec_composed_map(ubuf, &chunks[i]);\n"
+		"\tfor(i = 0; i < (long)n; i++)\n\t{\n"
+		"\t\tchunks[i].state = s + 1;\n"
+		"\t\ts = chunks[i].map[s];\n"
+		"\t}\n"
+		"#ifdef _OPENMP\n"
+		"#pragma omp parallel for schedule(dynamic, 1) reduction(min:tail)\n"
+		"#endif\n"
+		"\tfor(i = 0; i < (long)n; i++)\n\t{\n"
+		"\t\tsize_t t = rec_composed_tokens(ubuf, len, &chunks[i]);\n"
+		"\t\tif(t < tail) tail = t;\n"
+		"\t}\n"
+		"\tREC_STAT(rec_stats_counters.paused--);\n"
+		"\treturn tail;\n"
+		"}\n\n";
+}
+
+void generate_lexer(std::ostream& os, const insert_order_map<std::string, token_data>& token_map,
+	const Lexer_Dfa& dfa, const keyword_table& keywords, const dfa_profile* profile)
+{
+	bool bit_parallel = false;
+	bool nfa_fallback = false;
+	bool captures = false;
+	bool trailing_context = false;
+	for(const auto& [k, v] : token_map)
+	{
+		bit_parallel |= v.bit_parallel.has_value();
+		nfa_fallback |= v.nfa_fallback.has_value();
+		captures |= v.captures.has_value();
+		trailing_context |= v.trail != 0;
+	}
+	std::vector<std::string> conditions = start_conditions(token_map);
+	if(conditions.size() == 1) conditions.clear();
+	//the composed engine only runs the dfa and takes the lexeme to be the whole match, and
+	//like the incremental and parallel ones it starts every token in the same state
+	const lexer_info info = {token_map, dfa, keywords, !keywords.keywords.empty(), bit_parallel, nfa_fallback,
+		captures, trailing_context, dfa.backtrack_free(), !bit_parallel && !nfa_fallback && !trailing_context && conditions.empty() && composable(dfa),
+		profile, hot_loops(dfa, profile), std::move(conditions)};
+	emit_header(os, info);
+	emit_stats(os, info);
+	emit_tables(os, info);
+	if(info.keyword_split) emit_keywords(os, info);
+	if(info.bit_parallel) emit_bit_parallel(os, info);
+	if(info.nfa_fallback) emit_nfa(os, info);
+	if(info.captures) emit_captures(os, info);
+	emit_functions(os, info);
+	emit_lines(os, info);
+	emit_reach(os, info);
+	if(info.conditions.empty()) emit_incremental(os, info);
+	emit_push(os, info);
+	if(info.conditions.empty()) emit_parallel(os, info);
+	if(info.composed) emit_composed(os, info);
+	os << "#endif\n";
+}
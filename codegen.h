@@ -0,0 +1,15 @@
+#pragma once
+#include "input_parse.h"
+#include "insert_order_map.h"
+#include "lexer_dfa.h"
+#include "keywords.h"
+#include "profile.h"
+
+#include <ostream>
+#include <string>
+
+//writes a single header c lexer (also valid c++) matching the tokens of the token map
+//keywords are the tokens left out of the dfa that are recovered from their host's lexemes
+//profile (if not null) holds the hit counts of dfa on a sample input
+void generate_lexer(std::ostream& os, const insert_order_map<std::string, token_data>& token_map,
+	const Lexer_Dfa& dfa, const keyword_table& keywords, const dfa_profile* profile = nullptr);
@@ -1,55 +1,43 @@
 #include "dfa.h"
+#include "sparse_set.h"
 
 #include <utility>
 #include <iterator>
 #include <iostream>
+#include <limits>
+#include <array>
+#include <algorithm>
 
-Regex_Exception::Regex_Exception(const char* what) noexcept : m_what(what) {}
-Regex_Exception::Regex_Exception(const Regex_Exception& oth) noexcept : m_what(oth.m_what) {}
-Regex_Exception& Regex_Exception::operator=(const Regex_Exception& oth) noexcept
+bool construction_limit::exceeded(size_t states, size_t bytes) const noexcept
 {
-	m_what = oth.m_what;
-	return *this;
+	return states > max_states || bytes > max_bytes;
 }
-const char* Regex_Exception::what() const noexcept { return m_what; }
 
-static unsigned int lex_number(std::string_view& str)
+Nfa::Nfa(std::string_view regex) : Nfa(Regex_Ast(regex)) {}
+
+Nfa::Nfa(const Regex_Ast& ast) : m_states()
 {
-	if(str.empty()) throw Regex_Exception("encountered end of string too early");
-	unsigned int number = 0;
-	char ch = str.front();
-	if(!(ch >= '0' && ch <= '9')) throw Regex_Exception("failed to read number expected digit");
-	do
-	{
-		number *= 10;
-		number += static_cast<unsigned int>(ch-'0');
-		str.remove_prefix(1);
-		if(str.empty()) throw Regex_Exception("encountered end of string too early");
-		ch = str.front();
-	}while(ch >= '0' && ch <= '9');
-	return number;
+	emplace_new_state();
+	size_t fin_state = build(ast, ast.root(), 0);
+	m_states[fin_state].is_accepting = true;
 }
 
-/* regex cfg
-S  -> G S' $
-S' -> pipe S | eps
-G  -> U O G | eps
-U  -> ch | . | ( S ) | A
-O -> * | + | ? | { I N } | eps
-A  -> [ ch - ch A' ]
-A' -> ch - ch A' | eps
-I -> digit I'
-I' -> digit I' | eps
-N -> - I | + | eps
-*/
-
-Nfa::Nfa(std::string_view regex) : m_states()
+Nfa::Nfa(const Dfa& dfa) : m_states()
 {
-	emplace_new_state();
-	size_t fin_state = parse_regex(regex, 0);
-	if(!regex.empty())
+	const std::vector<Dfa::state>& dstates = dfa;
+	m_states.resize(dstates.size()+1);
+	size_t fin_state = dstates.size();
+	for(size_t i = 0; i < dstates.size(); i++)
 	{
-		throw Regex_Exception("string not empty at end of parse");
+		state& s = m_states[i];
+		s.is_accepting = false;
+		if(dstates[i].is_accepting) s.epsilon_transitions.insert(fin_state);
+		if(const size_t* omegat = std::get_if<size_t>(&dstates[i].transitions))
+		{
+			s.omega_transitions.insert(*omegat);
+			continue;
+		}
+		for(const auto& [ch, t] : *std::get_if<std::map<char, size_t>>(&dstates[i].transitions)) s.ch_transitions.emplace(ch, t);
 	}
 	m_states[fin_state].is_accepting = true;
 }
@@ -61,208 +49,420 @@ size_t Nfa::emplace_new_state()
 	return ret;
 }
 
-size_t Nfa::parse_regex(std::string_view& str, size_t in_state)
+//thompson construction, no construct adds transitions into its input state and
+//every construct ends in a state without outgoing transitions, so alternatives can
+//all start from the same state and optional parts can skip to the end
+size_t Nfa::build(const Regex_Ast& ast, size_t n, size_t in_state)
+{
+	const Regex_Ast::node& node = ast.nodes()[n];
+	size_t out_state;
+	switch(node.type)
+	{
+	default:
+	case Regex_Ast::node_type::empty:
+		return in_state;
+	case Regex_Ast::node_type::set:
+		out_state = emplace_new_state();
+		if(node.set.all())
+		{
+			m_states[in_state].omega_transitions.emplace(out_state);
+		}else
+		{
+			for(unsigned int ch = 0; ch < 256; ch++)
+			{
+				if(node.set[ch]) m_states[in_state].ch_transitions.emplace(static_cast<char>(ch), out_state);
+			}
+		}
+		return out_state;
+	case Regex_Ast::node_type::capture: //groups only matter to the tagged dfa
+		return build(ast, node.children[0], in_state);
+	case Regex_Ast::node_type::concat:
+		out_state = in_state;
+		for(size_t c : node.children) out_state = build(ast, c, out_state);
+		return out_state;
+	case Regex_Ast::node_type::alt:
+		out_state = emplace_new_state();
+		for(size_t c : node.children)
+		{
+			size_t fin_state = build(ast, c, in_state);
+			m_states[fin_state].epsilon_transitions.emplace(out_state);
+		}
+		return out_state;
+	case Regex_Ast::node_type::repeat:
+	{
+		size_t child = node.children[0];
+		size_t working_state = in_state;
+		if(node.max == Regex_Ast::unbounded)
+		{
+			//min-1 copies followed by a looping copy that can be skipped when min is 0
+			//the loop gets its own exit state so a later skip epsilon can't reach into it
+			for(unsigned int i = 1; i < node.min; i++) working_state = build(ast, child, working_state);
+			size_t loop_state = emplace_new_state();
+			m_states[working_state].epsilon_transitions.emplace(loop_state);
+			size_t fin_state = build(ast, child, loop_state);
+			m_states[fin_state].epsilon_transitions.emplace(loop_state);
+			out_state = emplace_new_state();
+			m_states[fin_state].epsilon_transitions.emplace(out_state);
+			if(node.min == 0) m_states[loop_state].epsilon_transitions.emplace(out_state);
+			return out_state;
+		}
+		for(unsigned int i = 0; i < node.min; i++) working_state = build(ast, child, working_state);
+		std::vector<size_t> skip_states;
+		for(unsigned int i = node.min; i < node.max; i++)
+		{
+			skip_states.push_back(working_state);
+			working_state = build(ast, child, working_state);
+		}
+		for(size_t s : skip_states) m_states[s].epsilon_transitions.emplace(working_state);
+		return working_state;
+	}
+	}
+}
+
+Nfa::operator const std::vector<Nfa::state>&() const noexcept { return m_states; }
+const std::vector<Nfa::state>& Nfa::states() const noexcept { return m_states; }
+
+//expands set to include every state reachable from it through epsilon transitions
+static void epsilon_closure(const std::vector<Nfa::state>& states, std::set<size_t>& set)
 {
-	size_t fin_state = emplace_new_state();
-	bool loop = true;
-	while(loop) //loop through all chunks seperated by alternation operator
+	std::vector<size_t> stack(set.cbegin(), set.cend());
+	while(!stack.empty())
 	{
-		size_t next_chunk = parse_chunk(str, in_state);
-		m_states[next_chunk].epsilon_transitions.emplace(fin_state);
-		if(str.empty()) break;
-		switch(str.front())
+		size_t s = stack.back();
+		stack.pop_back();
+		for(size_t e : states[s].epsilon_transitions)
 		{
-		case ')': loop = false; //intentional fallthrough
-		case '|': str.remove_prefix(1); break;
-		default: throw Regex_Exception("unexpected charachter at end of chunk, expected '|' or ')'");
+			if(set.insert(e).second) stack.push_back(e);
 		}
 	}
-	return fin_state;
 }
 
-size_t Nfa::parse_chunk(std::string_view& str, size_t in_state)
+size_t Nfa::longest_match(std::string_view str) const
 {
-	size_t working_state = in_state;
-	while(!str.empty())
+	sparse_set current(m_states.size()), next(m_states.size());
+	std::vector<size_t> stack;
+	//adds a thread for s and every state its epsilon transitions reach
+	auto add = [&](sparse_set& set, size_t s)
 	{
-		if(str.front() == '|' || str.front() == ')') break;
-		std::string_view scpy = str;
-		size_t efin_state = parse_element(str, working_state);
-		if(!str.empty())
+		if(!set.insert(s)) return;
+		stack.push_back(s);
+		while(!stack.empty())
 		{
-			switch(str.front())
+			size_t t = stack.back();
+			stack.pop_back();
+			for(size_t e : m_states[t].epsilon_transitions)
 			{
-			default: break;
-			case '*':
-				m_states[working_state].epsilon_transitions.emplace(efin_state);
-			case '+': //intentional fallthrough
-				m_states[efin_state].epsilon_transitions.emplace(working_state);
-				str.remove_prefix(1);
-				break;
-			case '?':
-				m_states[working_state].epsilon_transitions.emplace(efin_state);
-				str.remove_prefix(1);
-				break;
-			case '{':
+				if(set.insert(e)) stack.push_back(e);
+			}
+		}
+	};
+	auto accepting = [&](const sparse_set& set)
+	{
+		return std::any_of(set.begin(), set.end(), [&](size_t s){ return m_states[s].is_accepting; });
+	};
+	add(current, 0);
+	size_t ret = accepting(current) ? 0 : no_match;
+	for(size_t i = 0; i < str.size() && !current.empty(); i++)
+	{
+		next.clear();
+		for(size_t s : current)
+		{
+			auto [begin, end] = m_states[s].ch_transitions.equal_range(str[i]);
+			for(auto it = begin; it != end; ++it) add(next, it->second);
+			for(size_t o : m_states[s].omega_transitions) add(next, o);
+		}
+		std::swap(current, next);
+		if(accepting(current)) ret = i+1;
+	}
+	return ret;
+}
+
+bool Nfa::accepts(std::string_view str) const
+{
+	return longest_match(str) == str.size();
+}
+
+Dfa::Dfa(const Nfa& nfa) : m_states()
+{
+	subset_construction(nfa, construction_limit{});
+}
+
+std::optional<Dfa> Dfa::bounded(const Nfa& nfa, const construction_limit& limit)
+{
+	Dfa ret;
+	if(!ret.subset_construction(nfa, limit)) return std::nullopt;
+	return ret;
+}
+
+//subset construction, each dfa state is the epsilon closure of a set of nfa states
+bool Dfa::subset_construction(const Nfa& nfa, const construction_limit& limit)
+{
+	const std::vector<Nfa::state>& nstates = nfa;
+	std::map<std::set<size_t>, size_t> ids;
+	std::vector<const std::set<size_t>*> sets; //nfa states making up each dfa state
+	size_t bytes = 0;
+	auto get_state = [&](std::set<size_t>&& set)
+	{
+		epsilon_closure(nstates, set);
+		auto [it, did_insert] = ids.emplace(std::move(set), m_states.size());
+		if(did_insert)
+		{
+			bytes += sizeof(state)+sizeof(void*)+(it->first.size()+1)*construction_limit::node_bytes;
+			sets.push_back(&it->first);
+			state& s = m_states.emplace_back();
+			s.is_accepting = false;
+			for(size_t n : it->first) s.is_accepting |= nstates[n].is_accepting;
+		}
+		return it->second;
+	};
+	get_state({0});
+	for(size_t i = 0; i < m_states.size(); i++)
+	{
+		if(limit.exceeded(m_states.size(), bytes)) return false;
+		std::set<size_t> omega;
+		std::map<char, std::set<size_t>> moves;
+		for(size_t n : *sets[i])
+		{
+			omega.insert(nstates[n].omega_transitions.cbegin(), nstates[n].omega_transitions.cend());
+			for(const auto& [ch, t] : nstates[n].ch_transitions) moves[ch].insert(t);
+		}
+		if(!omega.empty() && moves.empty())
+		{
+			size_t t = get_state(std::move(omega));
+			m_states[i].transitions = t;
+			continue;
+		}
+		std::map<char, size_t> transitions;
+		if(omega.empty())
+		{
+			for(auto& [ch, set] : moves) transitions.emplace(ch, get_state(std::move(set)));
+		}else //every character has a transition, the specific ones add to the omega set
+		{
+			for(int c = std::numeric_limits<char>::min(); c <= std::numeric_limits<char>::max(); c++)
 			{
-				str.remove_prefix(1);
-				unsigned int min = lex_number(str);
-				unsigned int max;
-				std::vector<size_t> save_states;
-				switch(min)
-				{
-				case 0: m_states[working_state].epsilon_transitions.emplace(efin_state);
-				case 1: break;
-				default:
-					for(unsigned int i = 1; i < min; i++)
-					{
-						working_state = efin_state;
-						std::string_view scpy2 = scpy;
-						efin_state = parse_element(scpy2, working_state);
-					}
-				}
-				if(str.empty()) throw Regex_Exception("encountered end of string too early - expected '+', '-', or '}'");
-				switch(str.front())
-				{
-				default: throw Regex_Exception("encountered unexprected character in '{}' operator");
-				case '+':
-					m_states[efin_state].epsilon_transitions.emplace(working_state);
-					str.remove_prefix(1);
-					if(str.front() != '}') throw Regex_Exception("expected '}' in '{}' operator");
-				case '}':
-					str.remove_prefix(1);
-					break;
-				case '-':
-					str.remove_prefix(1);
-					max = lex_number(str);
-					if(max <= min) throw Regex_Exception("max is less than or equal to min inside '{}' operator");
-					for(unsigned int i = min; i < max; i++)
-					{
-						working_state = efin_state;
-						std::string_view scpy2 = scpy;
-						save_states.emplace_back(working_state);
-						efin_state = parse_element(scpy2, working_state);
-					}
-					for(size_t s : save_states)
-					{
-						m_states[s].epsilon_transitions.emplace(efin_state);
-					}
-					if(str.empty()) throw Regex_Exception("encountered end of string too early");
-					if(str.front() != '}') throw Regex_Exception("expected '}' in '{}' operator");
-					str.remove_prefix(1);
-				}
-			}}
+				std::set<size_t> set = omega;
+				auto it = moves.find(static_cast<char>(c));
+				if(it != moves.end()) set.insert(it->second.cbegin(), it->second.cend());
+				transitions.emplace(static_cast<char>(c), get_state(std::move(set)));
+			}
 		}
-		working_state = efin_state;
+		bytes += transitions.size()*construction_limit::node_bytes;
+		m_states[i].transitions = std::move(transitions);
 	}
-	return working_state;
+	return !limit.exceeded(m_states.size(), bytes);
 }
 
-size_t Nfa::parse_element(std::string_view& str, size_t in_state)
+//followpos construction (aho, sethi, ullman) of the position automaton
+namespace
 {
-	if(str.empty()) throw Regex_Exception("encountered end of string too early");
-	size_t out_state;
-	char ch = str.front();
-	str.remove_prefix(1);
-	switch(ch)
+	struct fragment
 	{
-	case '.': //any charachter
-		out_state = emplace_new_state();
-		m_states[in_state].omega_transitions.emplace(out_state);
-		break;
-	case '/': //escaped charachter
-		if(str.empty()) throw Regex_Exception("encountered end of string too early");
-		out_state = emplace_new_state();
-		ch = str.front();
-		str.remove_prefix(1);
-		switch(ch)
+		bool nullable;
+		std::set<size_t> first, last;
+	};
+}
+
+static fragment concat_fragments(std::vector<Glushkov_Nfa::position>& pos, fragment&& a, fragment&& b)
+{
+	for(size_t p : a.last) pos[p].follow.insert(b.first.cbegin(), b.first.cend());
+	fragment ret;
+	ret.nullable = a.nullable && b.nullable;
+	ret.first = std::move(a.first);
+	if(a.nullable) ret.first.insert(b.first.cbegin(), b.first.cend());
+	ret.last = std::move(b.last);
+	if(b.nullable) ret.last.insert(a.last.cbegin(), a.last.cend());
+	return ret;
+}
+
+//computes nullable, firstpos and lastpos of node n and adds its followpos edges
+//counted repeats are expanded so every copy gets its own positions
+static fragment build_fragment(const Regex_Ast& ast, size_t n, std::vector<Glushkov_Nfa::position>& pos)
+{
+	const Regex_Ast::node& node = ast.nodes()[n];
+	fragment ret{true, {}, {}};
+	switch(node.type)
+	{
+	default:
+	case Regex_Ast::node_type::empty:
+		return ret;
+	case Regex_Ast::node_type::set:
+		ret.nullable = false;
+		ret.first.insert(pos.size());
+		ret.last.insert(pos.size());
+		pos.push_back({node.set, {}});
+		return ret;
+	case Regex_Ast::node_type::capture:
+		return build_fragment(ast, node.children[0], pos);
+	case Regex_Ast::node_type::concat:
+		for(size_t c : node.children) ret = concat_fragments(pos, std::move(ret), build_fragment(ast, c, pos));
+		return ret;
+	case Regex_Ast::node_type::alt:
+		ret.nullable = false;
+		for(size_t c : node.children)
 		{
-		default:
-			m_states[in_state].ch_transitions.emplace(ch, out_state);
-			break;
-		case 'n':
-		case 'N':
-			m_states[in_state].ch_transitions.emplace('\n', out_state);
-			break;
-		case 't':
-		case 'T':
-			m_states[in_state].ch_transitions.emplace('\t', out_state);
-			break;
-		case 'r':
-		case 'R':
-			m_states[in_state].ch_transitions.emplace('\r', out_state);
-			break;
-		case 'v':
-		case 'V':
-			m_states[in_state].ch_transitions.emplace('\v', out_state);
-			break;
-		case 'f':
-		case 'F':
-			m_states[in_state].ch_transitions.emplace('\r', out_state);
-			break;
-		case 'a':
-		case 'A':
-			m_states[in_state].ch_transitions.emplace('\a', out_state);
-			break;
-		case 'b':
-		case 'B':
-			m_states[in_state].ch_transitions.emplace('\b', out_state);
-			break;
-		case 'z':
-		case 'Z':
-			m_states[in_state].ch_transitions.emplace(0, out_state);
-			break;
-		case 'S':
-			m_states[in_state].ch_transitions.emplace('\t', out_state);
-			m_states[in_state].ch_transitions.emplace('\v', out_state);
-			m_states[in_state].ch_transitions.emplace('\r', out_state);
-		case 's':
-			m_states[in_state].ch_transitions.emplace(' ', out_state);
-			break;
+			fragment f = build_fragment(ast, c, pos);
+			ret.nullable |= f.nullable;
+			ret.first.insert(f.first.cbegin(), f.first.cend());
+			ret.last.insert(f.last.cbegin(), f.last.cend());
 		}
-		break;
-	default: //a specific charachter
-		out_state = emplace_new_state();
-		m_states[in_state].ch_transitions.emplace(ch, out_state);
-		break;
-	case '(': //regex
-		out_state = parse_regex(str, in_state);
-		break;
-	case '[': //range of charachters
-		out_state = emplace_new_state();
-		while(str.front() != ']')
+		return ret;
+	case Regex_Ast::node_type::repeat:
+	{
+		size_t child = node.children[0];
+		if(node.max == Regex_Ast::unbounded)
+		{
+			//min-1 copies followed by a looping copy, x{3+} is xxx+
+			for(unsigned int i = 1; i < node.min; i++) ret = concat_fragments(pos, std::move(ret), build_fragment(ast, child, pos));
+			fragment loop = build_fragment(ast, child, pos);
+			for(size_t p : loop.last) pos[p].follow.insert(loop.first.cbegin(), loop.first.cend());
+			loop.nullable |= node.min == 0;
+			return concat_fragments(pos, std::move(ret), std::move(loop));
+		}
+		for(unsigned int i = 0; i < node.min; i++) ret = concat_fragments(pos, std::move(ret), build_fragment(ast, child, pos));
+		//optional copies nest, x{0-3} is (x(xx?)?)?
+		std::vector<fragment> optional;
+		for(unsigned int i = node.min; i < node.max; i++) optional.push_back(build_fragment(ast, child, pos));
+		fragment tail{true, {}, {}};
+		while(!optional.empty())
+		{
+			tail = concat_fragments(pos, std::move(optional.back()), std::move(tail));
+			tail.nullable = true;
+			optional.pop_back();
+		}
+		return concat_fragments(pos, std::move(ret), std::move(tail));
+	}
+	}
+}
+
+Glushkov_Nfa::Glushkov_Nfa(std::string_view regex) : Glushkov_Nfa(Regex_Ast(regex)) {}
+
+Glushkov_Nfa::Glushkov_Nfa(const Regex_Ast& ast) : m_positions(), m_first()
+{
+	fragment root = build_fragment(ast, ast.root(), m_positions);
+	size_t end = m_positions.size();
+	m_positions.emplace_back();
+	for(size_t p : root.last) m_positions[p].follow.insert(end);
+	if(root.nullable) root.first.insert(end);
+	m_first = std::move(root.first);
+}
+
+Glushkov_Nfa::operator const std::vector<Glushkov_Nfa::position>&() const noexcept { return m_positions; }
+const std::vector<Glushkov_Nfa::position>& Glushkov_Nfa::positions() const noexcept { return m_positions; }
+const std::set<size_t>& Glushkov_Nfa::first() const noexcept { return m_first; }
+size_t Glushkov_Nfa::end_marker() const noexcept { return m_positions.size()-1; }
+
+bool Glushkov_Nfa::accepts(std::string_view str) const
+{
+	std::set<size_t> current = m_first;
+	for(char ch : str)
+	{
+		std::set<size_t> next;
+		for(size_t p : current)
+		{
+			if(!m_positions[p].set.test(static_cast<unsigned char>(ch))) continue;
+			next.insert(m_positions[p].follow.cbegin(), m_positions[p].follow.cend());
+		}
+		if(next.empty()) return false;
+		current = std::move(next);
+	}
+	return current.count(end_marker()) != 0;
+}
+
+Dfa::Dfa(const Glushkov_Nfa& nfa) : m_states()
+{
+	followpos_construction(nfa, construction_limit{});
+}
+
+std::optional<Dfa> Dfa::bounded(const Glushkov_Nfa& nfa, const construction_limit& limit)
+{
+	Dfa ret;
+	if(!ret.followpos_construction(nfa, limit)) return std::nullopt;
+	return ret;
+}
+
+//each dfa state is a set of positions
+bool Dfa::followpos_construction(const Glushkov_Nfa& nfa, const construction_limit& limit)
+{
+	const std::vector<Glushkov_Nfa::position>& pos = nfa;
+	size_t end = nfa.end_marker();
+	std::map<std::set<size_t>, size_t> ids;
+	std::vector<const std::set<size_t>*> sets; //positions making up each dfa state
+	size_t bytes = 0;
+	auto get_state = [&](std::set<size_t>&& set)
+	{
+		auto [it, did_insert] = ids.emplace(std::move(set), m_states.size());
+		if(did_insert)
+		{
+			bytes += sizeof(state)+sizeof(void*)+(it->first.size()+1)*construction_limit::node_bytes;
+			sets.push_back(&it->first);
+			state& s = m_states.emplace_back();
+			s.is_accepting = it->first.count(end) != 0;
+		}
+		return it->second;
+	};
+	get_state(std::set<size_t>(nfa.first()));
+	for(size_t i = 0; i < m_states.size(); i++)
+	{
+		if(limit.exceeded(m_states.size(), bytes)) return false;
+		std::array<size_t, 256> targets;
+		for(unsigned int c = 0; c < 256; c++)
 		{
-			if(str.empty()) throw Regex_Exception("encountered end of string too early");
-			char min = str.front();
-			str.remove_prefix(1);
-			if(str.front() != '-') throw Regex_Exception("'-' required in character range");
-			str.remove_prefix(1);
-			if(str.empty()) throw Regex_Exception("encountered end of string too early");
-			char max = str.front();
-			str.remove_prefix(1);
-			if(max < min) std::swap(min, max);
-			for(ch = min; ch <= max; ch++)
+			std::set<size_t> set;
+			for(size_t p : *sets[i])
 			{
-				m_states[in_state].ch_transitions.emplace(ch, out_state);
+				if(pos[p].set[c]) set.insert(pos[p].follow.cbegin(), pos[p].follow.cend());
 			}
+			targets[c] = set.empty() ? no_state : get_state(std::move(set));
+		}
+		if(targets[0] != no_state && std::all_of(targets.cbegin(), targets.cend(), [&](size_t t){ return t == targets[0]; }))
+		{
+			m_states[i].transitions = targets[0];
+			continue;
 		}
-		str.remove_prefix(1);
-		break;
-	case '*': throw Regex_Exception("unexpected charachter '*'");
-	case '+': throw Regex_Exception("unexpected charachter '+'");
-	case '-': throw Regex_Exception("unexpected charachter '-'");
-	case '?': throw Regex_Exception("unexpected charachter '?'");
-	case ']': throw Regex_Exception("unexpected charachter ']'");
-	case '{': throw Regex_Exception("unexpected charachter '{'");
-	case '}': throw Regex_Exception("unexpected charachter '}'");
+		std::map<char, size_t> transitions;
+		for(unsigned int c = 0; c < 256; c++)
+		{
+			if(targets[c] != no_state) transitions.emplace(static_cast<char>(c), targets[c]);
+		}
+		bytes += transitions.size()*construction_limit::node_bytes;
+		m_states[i].transitions = std::move(transitions);
 	}
-	return out_state;
+	return !limit.exceeded(m_states.size(), bytes);
 }
 
-Nfa::operator const std::vector<Nfa::state>&() const noexcept { return m_states; }
-const std::vector<Nfa::state>& Nfa::states() const noexcept { return m_states; }
+Dfa Dfa::literal(std::string_view str)
+{
+	Dfa ret;
+	ret.m_states.resize(str.size()+1);
+	for(size_t i = 0; i < str.size(); i++)
+	{
+		ret.m_states[i].is_accepting = false;
+		ret.m_states[i].transitions = std::map<char, size_t>{{str[i], i+1}};
+	}
+	ret.m_states.back().is_accepting = true;
+	ret.m_states.back().transitions = std::map<char, size_t>();
+	return ret;
+}
+
+size_t Dfa::transition(size_t s, char ch) const noexcept
+{
+	const state& st = m_states[s];
+	if(const size_t* omegat = std::get_if<size_t>(&st.transitions)) return *omegat;
+	const std::map<char, size_t>& t = *std::get_if<std::map<char, size_t>>(&st.transitions);
+	auto it = t.find(ch);
+	return it == t.end() ? no_state : it->second;
+}
 
-Dfa::Dfa(const Nfa& nfa) {}
+bool Dfa::accepts(std::string_view str) const noexcept
+{
+	size_t s = 0;
+	for(char ch : str)
+	{
+		s = transition(s, ch);
+		if(s == no_state) return false;
+	}
+	return m_states[s].is_accepting;
+}
 
 Dfa::operator const std::vector<Dfa::state>&() const noexcept { return m_states; }
 const std::vector<Dfa::state>& Dfa::states() const noexcept { return m_states; }
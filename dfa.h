@@ -1,24 +1,31 @@
 #pragma once
+#include "regex_ast.h"
 
 #include <string_view>
-#include <exception>
+#include <string>
 #include <variant>
+#include <optional>
 #include <map>
 #include <set>
+#include <bitset>
 #include <vector>
 #include <ostream>
 #include <type_traits>
+#include <limits>
 
-class Regex_Exception : public std::exception
+class Dfa;
+
+//caps on the size of an automaton under construction, a construction gives up as soon as it
+//goes over either, memory is estimated from the containers the construction holds
+struct construction_limit
 {
-public:
-	Regex_Exception(const char* what) noexcept;
-	~Regex_Exception() = default;
-	Regex_Exception(const Regex_Exception& oth) noexcept;
-	Regex_Exception& operator=(const Regex_Exception& oth) noexcept;
-	const char* what() const noexcept override;
-private:
-	const char* m_what;
+	//rough cost of one node of a std::set or std::map, the links plus the value
+	static constexpr size_t node_bytes = 48;
+
+	size_t max_states = std::numeric_limits<size_t>::max();
+	size_t max_bytes = std::numeric_limits<size_t>::max();
+
+	bool exceeded(size_t states, size_t bytes) const noexcept;
 };
 
 class Nfa
@@ -34,27 +41,58 @@ public:
 	};
 
 	Nfa(std::string_view regex);
+	Nfa(const Regex_Ast& ast);
+	//the dfa as an nfa, its accepting states get an epsilon transition to a new final state
+	Nfa(const Dfa& dfa);
 	
 	operator const std::vector<state>&() const noexcept;
 	const std::vector<state>& states() const noexcept;
+	
+	static constexpr size_t no_match = static_cast<size_t>(-1);
+	
+	//pike vm simulation, every nfa state is a thread and each byte of str is read once, so
+	//it runs in O(str.size() * states().size()) whatever the regex
+	//returns the length of the longest prefix of str matched or no_match
+	size_t longest_match(std::string_view str) const;
+	//returns true if the whole string is matched
+	bool accepts(std::string_view str) const;
 private:
 	std::vector<state> m_states;
 	
 	//emplaces empty state and returns its index
 	size_t emplace_new_state();
-	//recursively parses a regex, takes the string and input state
-	//returns the index of the final state of the regex
 	
-	size_t parse_regex(std::string_view& str, size_t in_state);
-	
-	//recursively parses a chunk of a regex, takes the string and input state
-	//returns the index of the final state of the chunk
-	
-	size_t parse_chunk(std::string_view& str, size_t in_state);
-	
-	//recursively parses a single element of a regex, takes the string and input state
-	//returns the index of the final state of the chunk
-	size_t parse_element(std::string_view& str, size_t in_state);
+	//recursively builds the states matching node n of the ast starting from in_state
+	//returns the index of the final state of the node
+	size_t build(const Regex_Ast& ast, size_t n, size_t in_state);
+};
+
+//position (glushkov) automaton of a regex, one position per character set occurrence in
+//the regex with counted repeats expanded, plus an end marker position that matches nothing
+//a set of positions is the set of bytes that may come next, it accepts if it holds the marker
+class Glushkov_Nfa
+{
+public:
+
+	struct position
+	{
+		std::bitset<256> set; //bytes matched by the position, indexed by unsigned byte
+		std::set<size_t> follow; //positions that can come after it
+	};
+
+	Glushkov_Nfa(std::string_view regex);
+	Glushkov_Nfa(const Regex_Ast& ast);
+
+	operator const std::vector<position>&() const noexcept;
+	const std::vector<position>& positions() const noexcept;
+	//positions that can match the first byte, includes the end marker if the regex matches ""
+	const std::set<size_t>& first() const noexcept;
+	size_t end_marker() const noexcept;
+	//simulates the position automaton on the whole string
+	bool accepts(std::string_view str) const;
+private:
+	std::vector<position> m_positions;
+	std::set<size_t> m_first;
 };
 
 class Dfa
@@ -67,12 +105,35 @@ public:
 		std::variant<size_t, std::map<char, size_t>> transitions;
 	};
 
+	static constexpr size_t no_state = static_cast<size_t>(-1);
+
 	Dfa(const Nfa& nfa);
+	//builds the dfa directly from the position automaton (followpos construction), the
+	//glushkov nfa has no epsilon transitions so there are no closures to compute
+	Dfa(const Glushkov_Nfa& nfa);
+	
+	//builds the dfa of a regex matching a single literal string directly, skipping the nfa
+	static Dfa literal(std::string_view str);
+	//builds the dfa unless it goes over the limit, determinization can blow up exponentially
+	//so the construction checks the limit after every state
+	static std::optional<Dfa> bounded(const Nfa& nfa, const construction_limit& limit);
+	static std::optional<Dfa> bounded(const Glushkov_Nfa& nfa, const construction_limit& limit);
 	
 	operator const std::vector<state>&() const noexcept;
 	const std::vector<state>& states() const noexcept;
+	
+	//returns the state reached from state s on ch or no_state if there is no transition
+	size_t transition(size_t s, char ch) const noexcept;
+	//returns true if the whole string is matched
+	bool accepts(std::string_view str) const noexcept;
 private:
+	Dfa() = default;
+	
 	std::vector<state> m_states;
+	
+	//the constructions, return false if they stopped after going over the limit
+	bool subset_construction(const Nfa& nfa, const construction_limit& limit);
+	bool followpos_construction(const Glushkov_Nfa& nfa, const construction_limit& limit);
 };
 
 std::ostream& operator<<(std::ostream& os, const Nfa::state& state);
@@ -4,10 +4,17 @@
 #include <fstream>
 #include <exception>
 #include <string>
+#include <string_view>
 #include <cstring>
 #include <cctype>
 #include <limits>
 #include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <sstream>
+#include <unordered_map>
+#include <atomic>
+#include <thread>
 
 static inline void check_stream_should_close(std::istream& is)
 {
@@ -146,6 +153,29 @@ static insert_order_map<std::string, token_data> read_stream(std::istream& is)
 				ilex_state = -1;
 				break;
 			case 1: //name
+				if(ch == '<' && tk_name.empty() && tk_data.conditions.empty())
+				{
+					tk_data.conditions.emplace_back();
+					ilex_state = 4;
+					break;
+				}
+				if(ch == '>' && !tk_name.empty())
+				{
+					ilex_state = 5;
+					break;
+				}
+				if(ch == '~' && tk_name.empty() && !tk_data.case_insensitive)
+				{
+					tk_data.case_insensitive = true;
+					break;
+				}
+				//-<*>ws is an ignored token, <*>-ws would be a standard one named -ws
+				if(tk_name.empty() && (!tk_data.conditions.empty() || tk_data.case_insensitive)
+					&& (ch == '.' || ch == '-' || ch == '+' || ch == '!'))
+				{
+					std::cerr << "error: the mode goes before the start conditions and '~' on line " << lineno << '\n';
+					std::exit(1);
+				}
 				if(valid_name_ch(ch))
 				{
 					tk_name += ch;
@@ -154,6 +184,29 @@ static insert_order_map<std::string, token_data> read_stream(std::istream& is)
 				}
 				std::cerr << "error: invalid token name on line " << lineno << '\n';
 				std::exit(1);
+			case 4: //start conditions, <a,b> before the name
+				if((ch == '>' || ch == ',') && !tk_data.conditions.back().empty())
+				{
+					if(ch == ',') tk_data.conditions.emplace_back();
+					else ilex_state = -1;
+					break;
+				}
+				if(valid_name_ch(ch) || (ch == '*' && tk_data.conditions.back().empty()))
+				{
+					tk_data.conditions.back() += static_cast<char>(ch);
+					break;
+				}
+				std::cerr << "error: invalid start condition on line " << lineno << '\n';
+				std::exit(1);
+			case 5: //start condition to switch to, >c after the name
+				if(valid_name_ch(ch))
+				{
+					tk_data.begin += static_cast<char>(ch);
+					if(isspace(is.peek())) ilex_state = -2;
+					break;
+				}
+				std::cerr << "error: invalid start condition on line " << lineno << '\n';
+				std::exit(1);
 			case 3: //regex step 2
 				rstr += '|';
 				ilex_state = 2;
@@ -183,19 +236,66 @@ static insert_order_map<std::string, token_data> read_stream(std::istream& is)
 		}
 	}
 	check_stream_should_close(is);
+	std::vector<std::string> conditions = start_conditions(ret);
+	if(conditions.size() > 64)
+	{
+		std::cerr << "error: more than 64 start conditions\n";
+		std::exit(1);
+	}
+	for(const auto& [k, v] : ret)
+	{
+		if(v.begin.empty() || std::find(conditions.cbegin(), conditions.cend(), v.begin) != conditions.cend()) continue;
+		std::cerr << "error: token '" << k << "' switches to start condition '" << v.begin << "' that no token is active in\n";
+		std::exit(1);
+	}
 	return ret;
 }
 
-static insert_order_map<std::string, token_data> read_input(int argc, const char** argv)
+std::vector<std::string> start_conditions(const insert_order_map<std::string, token_data>& token_map)
 {
-	if(argc >= 2) //input file
+	std::vector<std::string> ret = {"initial"};
+	for(const auto& [k, v] : token_map)
+	{
+		for(const std::string& c : v.conditions)
+		{
+			if(c != "*" && std::find(ret.cbegin(), ret.cend(), c) == ret.cend()) ret.push_back(c);
+		}
+	}
+	return ret;
+}
+
+std::vector<size_t> condition_switches(const insert_order_map<std::string, token_data>& token_map)
+{
+	std::vector<std::string> conditions = start_conditions(token_map);
+	std::vector<size_t> ret;
+	for(const auto& [k, v] : token_map)
+	{
+		auto it = std::find(conditions.cbegin(), conditions.cend(), v.begin);
+		ret.push_back(v.begin.empty() ? no_condition : static_cast<size_t>(it-conditions.cbegin()));
+	}
+	return ret;
+}
+
+bool active_in(const token_data& tk, const std::string& condition)
+{
+	if(tk.conditions.empty()) return condition == "initial";
+	for(const std::string& c : tk.conditions)
+	{
+		if(c == "*" || c == condition) return true;
+	}
+	return false;
+}
+
+static insert_order_map<std::string, token_data> read_input(const char* input)
+{
+	if(input != nullptr) //input file
 	{
 #ifdef DEBUG
-		std::cout << "debug: opening file: " << argv[1] << '\n';
+		std::cout << "debug: opening file: " << input << '\n';
 #endif
-		std::ifstream file(argv[1]);
+		std::ifstream file(input);
 		if (!file.is_open()) {
-			std::cerr << "error: could not open file: " << argv[1] << '\n';
+			std::cerr << "error: could not open file: " << input << '\n';
 			if (file.bad()) {
 				std::cerr << "badbit is set.\n";
 			}
@@ -214,32 +314,328 @@ static insert_order_map<std::string, token_data> read_input(int argc, const char
 	}
 }
 
-insert_order_map<std::string, token_data> parse_input(int argc, const char** argv)
+//reads a positive number of bytes with an optional k, m or g suffix
+static bool parse_size(const char* str, size_t& out)
 {
-	insert_order_map<std::string, token_data> token_map = read_input(argc, argv);
-	for(auto& [k, v] : token_map)
+	char* end = nullptr;
+	unsigned long long n = std::strtoull(str, &end, 10);
+	if(end == str) return false;
+	switch(*end)
 	{
-		try
+	case 'k': case 'K': n <<= 10; end++; break;
+	case 'm': case 'M': n <<= 20; end++; break;
+	case 'g': case 'G': n <<= 30; end++; break;
+	}
+	if(*end != '\0' || n == 0) return false;
+	out = static_cast<size_t>(n);
+	return true;
+}
+
+options parse_args(int argc, const char** argv)
+{
+	options opts;
+	int positional = 0;
+	for(int i = 1; i < argc; i++)
+	{
+		std::string_view arg = argv[i];
+		if(arg == "--keyword-split")
+		{
+			opts.keyword_split = true;
+		}else if(arg == "--direct-dfa")
+		{
+			opts.direct_dfa = true;
+		}else if(arg == "--bit-parallel")
+		{
+			opts.bit_parallel = true;
+		}else if(arg == "--case-insensitive")
+		{
+			opts.case_insensitive = true;
+		}else if(arg == "--profile-corpus")
+		{
+			if(++i == argc)
+			{
+				std::cerr << "error: --profile-corpus expects a file\n";
+				std::exit(1);
+			}
+			opts.profile_corpus = argv[i];
+		}else if(arg == "--dfa-budget")
+		{
+			char* end = nullptr;
+			if(++i == argc || (opts.dfa_budget = std::strtoul(argv[i], &end, 10), *end != '\0' || opts.dfa_budget == 0))
+			{
+				std::cerr << "error: --dfa-budget expects a positive number of states\n";
+				std::exit(1);
+			}
+		}else if(arg == "--max-dfa-states")
+		{
+			char* end = nullptr;
+			if(++i == argc || (opts.max_dfa_states = std::strtoul(argv[i], &end, 10), *end != '\0' || opts.max_dfa_states == 0))
+			{
+				std::cerr << "error: --max-dfa-states expects a positive number of states\n";
+				std::exit(1);
+			}
+		}else if(arg == "--max-memory")
+		{
+			if(++i == argc || !parse_size(argv[i], opts.max_memory))
+			{
+				std::cerr << "error: --max-memory expects a positive number of bytes (k, m or g suffix allowed)\n";
+				std::exit(1);
+			}
+		}else if(arg == "--batch")
+		{
+			if(i+2 >= argc)
+			{
+				std::cerr << "error: --batch expects a spec and an output file\n";
+				std::exit(1);
+			}
+			opts.batch.emplace_back(argv[i+1], argv[i+2]);
+			i += 2;
+		}else if(arg == "--verify")
+		{
+			char* end = nullptr;
+			if(++i == argc || (opts.verify_seed = std::strtoul(argv[i], &end, 10), *end != '\0'))
+			{
+				std::cerr << "error: --verify expects a numeric seed\n";
+				std::exit(1);
+			}
+		}else if(arg == "--verify-codegen")
+		{
+			char* end = nullptr;
+			if(++i == argc || (opts.verify_codegen_seed = std::strtoul(argv[i], &end, 10), *end != '\0'))
+			{
+				std::cerr << "error: --verify-codegen expects a numeric seed\n";
+				std::exit(1);
+			}
+		}else if(arg.size() > 1 && arg.front() == '-')
+		{
+			std::cerr << "error: unknown option: " << arg << '\n';
+			std::exit(1);
+		}else
+		{
+			switch(positional++)
+			{
+			case 0: opts.input = argv[i]; break;
+			case 1: opts.output = argv[i]; break;
+			default:
+				std::cerr << "error: unexpected argument: " << arg << '\n';
+				std::exit(1);
+			}
+		}
+	}
+	if(!opts.batch.empty() && positional != 0)
+	{
+		std::cerr << "error: --batch takes the place of the spec and output arguments\n";
+		std::exit(1);
+	}
+	return opts;
+}
+
+construction_limit dfa_limit(const options& opts)
+{
+	construction_limit ret;
+	if(opts.dfa_budget != 0) ret.max_states = opts.dfa_budget;
+	if(opts.max_dfa_states != 0) ret.max_states = std::min(ret.max_states, opts.max_dfa_states);
+	if(opts.max_memory != 0) ret.max_bytes = opts.max_memory;
+	return ret;
+}
+
+std::string describe_limits(const options& opts)
+{
+	std::string ret;
+	if(opts.max_dfa_states != 0) ret += "--max-dfa-states " + std::to_string(opts.max_dfa_states);
+	if(opts.max_dfa_states != 0 && opts.max_memory != 0) ret += ", ";
+	if(opts.max_memory != 0) ret += "--max-memory " + std::to_string(opts.max_memory) + " bytes";
+	return ret;
+}
+
+//compiles the regex a token was read with, on failure writes the error to err and returns
+//the exit code, the name is only used in messages
+static int compile_token(const std::string& k, token_data& v, const options& opts,
+	const construction_limit& limit, std::ostream& err)
+{
+	try
+	{
+		const bool fold_case = opts.case_insensitive || v.case_insensitive;
+		std::string literal;
+		if(regex_literal(std::get<std::string>(v.regex), literal) && !(fold_case && has_letter(literal)))
+		{
+#ifdef DEBUG
+			std::cout << "debug: token '" << k << "' is a literal, skipping nfa construction\n";
+#endif
+			v.regex.emplace<Dfa>(Dfa::literal(literal));
+			v.literal = std::move(literal);
+			return 0;
+		}
+		Regex_Ast ast(std::get<std::string>(v.regex), fold_case);
+		//the lexer dfa only finds the token, its groups are found afterwards in the lexeme
+		if(ast.groups() > 0)
+		{
+			v.captures = Tagged_Dfa::bounded(ast, limit);
+			if(!v.captures && opts.dfa_budget == 0)
+			{
+				err << "error: tagged dfa of token '" << k << "' went over the limit (" << describe_limits(opts) << ")\n";
+				err << "note: with --dfa-budget its capture groups are dropped instead of failing\n";
+				return 4;
+			}
+			//there is no simulation that records tags, so the rule is still lexed but
+			//rec_captures doesn't know it
+			if(!v.captures) err << "warning: tagged dfa of token '" << k << "' went over the limit, dropping its capture groups\n";
+		}
+		if(ast.trail() != Regex_Ast::no_node)
+		{
+			//the scan matches the context too, maximal munch counts it like flex does, and
+			//the generated lexer cuts the lexeme out of the match by whichever length is fixed
+			auto [hmin, hmax] = ast.length_bounds(ast.head());
+			v.trail = hmin == hmax ? static_cast<long>(hmin) : -static_cast<long>(ast.length_bounds(ast.trail()).first);
+		}
+		std::optional<Glushkov_Nfa> glushkov;
+		if(opts.direct_dfa || opts.bit_parallel) glushkov.emplace(ast);
+		std::optional<Dfa> dfa;
+		if(opts.direct_dfa)
+		{
+#ifdef DEBUG
+			std::cout << "debug: constructing dfa directly for token '" << k;
+			std::cout << "' with regex '" << std::get<std::string>(v.regex) << "'\n";
+#endif
+			dfa = Dfa::bounded(*glushkov, limit);
+		}else
 		{
 #ifdef DEBUG
 			std::cout << "debug: constructing nfa for token '" << k;
 			std::cout << "' with regex '" << std::get<std::string>(v.regex) << "'\n";
 #endif
-			Nfa nfa(std::get<std::string>(v.regex));
+			Nfa nfa(ast);
 #ifdef DEBUG
 			std::cout << nfa << '\n';
 			std::cout << "debug: constructing dfa for token '" << k << "'\n";
 #endif
-			v.regex.emplace<Dfa>(nfa);
+			dfa = Dfa::bounded(nfa, limit);
+		}
+		if(!dfa && opts.dfa_budget == 0)
+		{
+			err << "error: dfa of token '" << k << "' went over the limit (" << describe_limits(opts) << ")\n";
+			err << "note: with --dfa-budget rules over the limit are simulated instead of failing\n";
+			return 4;
+		}
+		if(!dfa)
+		{
+			//the generated lexer simulates the rule instead, bit parallel if it is small
+			//enough and on its thompson nfa otherwise, linear in the bytes each token
+			//attempt reads but slower per byte than a table lookup
+			if(opts.bit_parallel && glushkov->positions().size() <= 64)
+			{
+#ifdef DEBUG
+				std::cout << "debug: dfa of token '" << k << "' went over the limit, simulating it bit parallel instead\n";
+#endif
+				v.bit_parallel = std::move(glushkov);
+				return 0;
+			}
+#ifdef DEBUG
+			std::cout << "debug: dfa of token '" << k << "' went over the limit, simulating its nfa instead\n";
+#endif
+			v.nfa_fallback.emplace(ast);
+			return 0;
+		}
+		v.regex.emplace<Dfa>(std::move(*dfa));
 #ifdef DEBUG
-			std::cout << std::get<Dfa>(v.regex) << '\n';
+		std::cout << std::get<Dfa>(v.regex) << '\n';
 #endif
-		}catch(const std::exception& e)
+		//a dfa with more states than the position automaton has blown up in determinization,
+		//small enough rules are simulated with one bit per position in the generated lexer
+		if(opts.bit_parallel && glushkov->positions().size() <= 64)
 		{
-			std::cerr << "error: failed to parse regex: token '" << k;
-			std::cerr << "':" << e.what() << '\n';
-			std::exit(2);
+			std::optional<Dfa> direct;
+			if(!opts.direct_dfa) direct = Dfa::bounded(*glushkov, limit);
+			size_t dfa_states = opts.direct_dfa ? std::get<Dfa>(v.regex).states().size() : direct ? direct->states().size() : limit.max_states;
+			if(dfa_states > glushkov->positions().size())
+			{
+#ifdef DEBUG
+				std::cout << "debug: token '" << k << "' is simulated bit parallel, " << dfa_states;
+				std::cout << " dfa states for " << glushkov->positions().size() << " positions\n";
+#endif
+				v.bit_parallel = std::move(glushkov);
+			}
 		}
+	}catch(const std::exception& e)
+	{
+		err << "error: failed to parse regex: token '" << k;
+		err << "':" << e.what() << '\n';
+		return 2;
+	}
+	return 0;
+}
+
+insert_order_map<std::string, token_data> parse_input(const options& opts)
+{
+	const construction_limit limit = dfa_limit(opts);
+	insert_order_map<std::string, token_data> token_map = read_input(opts.input);
+	for(auto& [k, v] : token_map)
+	{
+		if(int code = compile_token(k, v, opts, limit, std::cerr)) std::exit(code);
 	}
 	return token_map;
 }
+
+std::vector<insert_order_map<std::string, token_data>> parse_batch(const options& opts)
+{
+	const construction_limit limit = dfa_limit(opts);
+	std::vector<insert_order_map<std::string, token_data>> specs;
+	for(const auto& [input, output] : opts.batch) specs.push_back(read_input(input));
+	//the first token using a regex names it in messages
+	struct unique_regex
+	{
+		const std::string* name;
+		token_data data;
+		std::ostringstream err;
+		int code = 0;
+	};
+	//a case folded regex is another regex, the key starts with whether it's folded
+	auto key = [](const token_data& v){ return (v.case_insensitive ? 'i' : 's') + std::get<std::string>(v.regex); };
+	std::unordered_map<std::string, size_t> ids;
+	std::vector<unique_regex> unique;
+	for(const insert_order_map<std::string, token_data>& spec : specs)
+	{
+		for(const auto& [k, v] : spec)
+		{
+			if(!ids.emplace(key(v), unique.size()).second) continue;
+			unique_regex& u = unique.emplace_back();
+			u.name = &k;
+			u.data = v;
+		}
+	}
+#ifdef DEBUG
+	std::cout << "debug: " << unique.size() << " distinct regexes in " << specs.size() << " specs\n";
+#endif
+	std::atomic<size_t> next = 0;
+	auto work = [&]()
+	{
+		for(size_t i = next++; i < unique.size(); i = next++)
+		{
+			unique[i].code = compile_token(*unique[i].name, unique[i].data, opts, limit, unique[i].err);
+		}
+	};
+	std::vector<std::thread> threads;
+	size_t workers = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), unique.size());
+	for(size_t i = 1; i < workers; i++) threads.emplace_back(work);
+	work();
+	for(std::thread& t : threads) t.join();
+	for(const unique_regex& u : unique)
+	{
+		//warnings too, in spec order
+		std::cerr << u.err.str();
+		if(u.code != 0) std::exit(u.code);
+	}
+	for(insert_order_map<std::string, token_data>& spec : specs)
+	{
+		for(auto& [k, v] : spec)
+		{
+			//what the token does once matched is its own, only the compiled regex is shared
+			token_data compiled = unique[ids.at(key(v))].data;
+			compiled.mode = v.mode;
+			compiled.conditions = std::move(v.conditions);
+			compiled.begin = std::move(v.begin);
+			v = std::move(compiled);
+		}
+	}
+	return specs;
+}
@@ -1,9 +1,13 @@
 #pragma once
 #include "dfa.h"
+#include "tagged_dfa.h"
 #include "insert_order_map.h"
 
 #include <string>
 #include <variant>
+#include <optional>
+#include <vector>
+#include <utility>
 
 struct token_data
 {
@@ -12,6 +16,52 @@ struct token_data
 		standard, save, ignore, error
 	} mode;
 	std::variant<std::string, Dfa> regex;
+	std::string literal; //the unescaped string if the regex is a plain literal, otherwise empty
+	std::optional<Glushkov_Nfa> bit_parallel; //set if the token is simulated bit parallel instead of joining the lexer dfa
+	std::optional<Nfa> nfa_fallback; //set (and regex left a string) if the token's dfa went over the state budget
+	std::optional<Tagged_Dfa> captures; //set if the regex has capture groups, resolves them in a matched lexeme
+	//trailing context '(?=...)' of the regex, the lexeme is the first trail bytes of the match
+	//if it's positive and the match without its last -trail bytes if it's negative
+	long trail = 0;
+	std::vector<std::string> conditions; //start conditions the rule is active in, only initial if empty, all with "*"
+	std::string begin; //start condition the lexer switches to after the token, empty to stay
+	bool case_insensitive = false; //'~' before the name, letters match either case
 };
 
-insert_order_map<std::string, token_data> parse_input(int argc, const char** argv);
+struct options
+{
+	const char* input = nullptr; //spec file, stdin when null
+	const char* output = nullptr; //generated lexer, stdout when null
+	std::vector<std::pair<const char*, const char*>> batch; //spec and output of every lexer of a --batch run
+	const char* profile_corpus = nullptr; //sample input guiding code generation
+	bool keyword_split = false;
+	bool direct_dfa = false; //followpos construction instead of nfa and subset construction
+	bool bit_parallel = false;
+	bool case_insensitive = false; //every token's letters match either case
+	size_t dfa_budget = 0; //most states a token's dfa may have before its nfa is simulated instead, 0 for no limit
+	size_t max_dfa_states = 0; //hard cap on the states of any dfa built, 0 for no limit
+	size_t max_memory = 0; //hard cap on the estimated bytes of any dfa under construction, 0 for no limit
+	std::optional<unsigned long> verify_seed; //cross check the automaton constructions instead of generating a lexer
+	std::optional<unsigned long> verify_codegen_seed; //compile and run generated lexers against a reference instead
+};
+
+options parse_args(int argc, const char** argv);
+
+//start conditions of a spec, "initial" first and the others in order of first use
+std::vector<std::string> start_conditions(const insert_order_map<std::string, token_data>& token_map);
+//true if the rule is active in the start condition
+bool active_in(const token_data& tk, const std::string& condition);
+constexpr size_t no_condition = static_cast<size_t>(-1);
+//index in start_conditions of the condition each token switches to, no_condition to stay
+std::vector<size_t> condition_switches(const insert_order_map<std::string, token_data>& token_map);
+
+//the limit dfa constructions run under, the smaller of --dfa-budget and --max-dfa-states
+construction_limit dfa_limit(const options& opts);
+//the hard caps for error messages, like "--max-dfa-states 1000, --max-memory 1048576 bytes"
+std::string describe_limits(const options& opts);
+
+insert_order_map<std::string, token_data> parse_input(const options& opts);
+
+//reads every spec of opts.batch, each distinct regex is compiled once (on every core) and
+//shared by all the tokens using it, returns the token maps in the order of opts.batch
+std::vector<insert_order_map<std::string, token_data>> parse_batch(const options& opts);
@@ -0,0 +1,166 @@
+#include "keywords.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <map>
+#include <iostream>
+#include <cstdlib>
+
+static constexpr size_t no_host = static_cast<size_t>(-1);
+//distinct literals collide under some seed with tiny odds, running out means duplicates
+static constexpr uint32_t max_seeds = 1024;
+
+std::vector<keyword> find_keywords(const insert_order_map<std::string, token_data>& token_map)
+{
+	std::vector<std::string> conditions = start_conditions(token_map);
+	auto shares_condition = [&](const token_data& a, const token_data& b)
+	{
+		for(const std::string& c : conditions)
+		{
+			if(active_in(a, c) && active_in(b, c)) return true;
+		}
+		return false;
+	};
+	auto same_conditions = [&](const token_data& a, const token_data& b)
+	{
+		for(const std::string& c : conditions)
+		{
+			if(active_in(a, c) != active_in(b, c)) return false;
+		}
+		return true;
+	};
+	std::vector<keyword> ret;
+	for(auto kit = token_map.begin(); kit != token_map.end(); kit++)
+	{
+		const std::string& literal = kit->second.literal;
+		if(literal.empty()) continue;
+		//the host is the earliest other token matching the literal, an earlier token with
+		//the same literal shadows this one and a later one is the host since it stays in
+		//the dfa and wins the literal, tokens never active in the same start condition as
+		//the keyword don't compete with it
+		size_t host = no_host;
+		bool shadowed = false;
+		for(auto it = token_map.begin(); it != token_map.end(); it++)
+		{
+			if(it != kit && !shares_condition(it->second, kit->second)) continue;
+			if(it == kit || (it < kit && it->second.literal == literal))
+			{
+				if(it < kit) shadowed = true;
+				continue;
+			}
+			const token_data& tk = it->second;
+			const Dfa* dfa = std::get_if<Dfa>(&tk.regex);
+			bool match = dfa ? dfa->accepts(literal) : tk.nfa_fallback ? tk.nfa_fallback->accepts(literal) : tk.bit_parallel->accepts(literal);
+			if(match)
+			{
+				//a host with trailing context doesn't end where the keyword would, and one
+				//active in other start conditions would find the keyword where it isn't
+				if(it > kit && tk.trail == 0 && same_conditions(tk, kit->second))
+				{
+					host = static_cast<size_t>(std::distance(token_map.begin(), it));
+				}
+				break;
+			}
+		}
+		if(shadowed || host == no_host) continue;
+		ret.push_back({static_cast<size_t>(std::distance(token_map.begin(), kit)), host, literal});
+	}
+	//the same literal in start conditions that don't overlap would need two slots with one
+	//hash, those stay in the dfa
+	std::map<std::string, size_t> uses;
+	for(const keyword& k : ret) uses[k.literal]++;
+	ret.erase(std::remove_if(ret.begin(), ret.end(), [&](const keyword& k){ return uses[k.literal] > 1; }), ret.end());
+	return ret;
+}
+
+uint32_t keyword_hash(std::string_view str, uint32_t seed) noexcept
+{
+	uint32_t h = 2166136261u ^ seed;
+	for(char ch : str)
+	{
+		h ^= static_cast<unsigned char>(ch);
+		h *= 16777619u;
+	}
+	return h;
+}
+
+uint32_t keyword_mix(uint32_t h) noexcept
+{
+	h ^= h >> 16;
+	h *= 0x7feb352du;
+	h ^= h >> 15;
+	h *= 0x846ca68bu;
+	h ^= h >> 16;
+	return h;
+}
+
+//hash and displace, buckets are placed largest first by searching for a displacement
+//that sends all of their keys to free slots
+static bool try_build(keyword_table& table, const std::vector<keyword>& keywords, size_t bucket_count)
+{
+	const size_t n = keywords.size();
+	std::vector<uint32_t> hashes(n);
+	std::vector<std::vector<size_t>> buckets(bucket_count);
+	for(size_t i = 0; i < n; i++)
+	{
+		hashes[i] = keyword_hash(keywords[i].literal, table.seed);
+		buckets[hashes[i] % bucket_count].push_back(i);
+	}
+	std::vector<size_t> order(bucket_count);
+	for(size_t i = 0; i < bucket_count; i++) order[i] = i;
+	std::stable_sort(order.begin(), order.end(),
+		[&](size_t a, size_t b){ return buckets[a].size() > buckets[b].size(); });
+	
+	table.displacements.assign(bucket_count, 0);
+	std::vector<size_t> slots(n, n); //keyword index in each slot, n when free
+	std::vector<size_t> placed;
+	for(size_t b : order)
+	{
+		if(buckets[b].empty()) break;
+		uint32_t d = 0;
+		for(; d < (1u << 16); d++)
+		{
+			placed.clear();
+			for(size_t k : buckets[b])
+			{
+				size_t slot = keyword_mix(hashes[k] ^ d) % n;
+				if(slots[slot] != n) break;
+				slots[slot] = k;
+				placed.push_back(slot);
+			}
+			if(placed.size() == buckets[b].size()) break;
+			for(size_t slot : placed) slots[slot] = n;
+		}
+		if(d == (1u << 16)) return false;
+		table.displacements[b] = d;
+	}
+	table.keywords.clear();
+	for(size_t k : slots) table.keywords.push_back(keywords[k]);
+	return true;
+}
+
+keyword_table build_keyword_table(std::vector<keyword> keywords)
+{
+	keyword_table table;
+	table.seed = 0;
+	if(keywords.empty()) return table;
+	size_t bucket_count = keywords.size()/4 + 1;
+	while(!try_build(table, keywords, bucket_count))
+	{
+		//a hash collision between two literals can't be displaced, change the seed
+		if(bucket_count >= keywords.size())
+		{
+			if(++table.seed == max_seeds)
+			{
+				std::cerr << "error: no perfect hash found for the " << keywords.size() << " keywords\n";
+				std::exit(1);
+			}
+			bucket_count = keywords.size()/4 + 1;
+		}else
+		{
+			bucket_count *= 2;
+		}
+	}
+	return table;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "input_parse.h"
+#include "insert_order_map.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//a literal token that a later token (usually an identifier rule) also matches, the
+//keyword can be left out of the lexer dfa and recovered from the host's lexeme
+struct keyword
+{
+	size_t token; //index of the keyword in the token map
+	size_t host; //index of the token that matches the keyword once it is removed
+	std::string literal;
+};
+
+//minimal perfect hash over the keyword literals, the keyword with literal str is stored at
+//keyword_mix(h ^ displacements[h % displacements.size()]) % keywords.size()
+//where h = keyword_hash(str, seed)
+struct keyword_table
+{
+	uint32_t seed;
+	std::vector<uint32_t> displacements;
+	std::vector<keyword> keywords; //ordered by hash index
+};
+
+//finds every literal token whose lexemes would be matched by a later token if it was removed
+std::vector<keyword> find_keywords(const insert_order_map<std::string, token_data>& token_map);
+
+keyword_table build_keyword_table(std::vector<keyword> keywords);
+
+//fnv-1a, the generated lexer uses the same functions
+uint32_t keyword_hash(std::string_view str, uint32_t seed) noexcept;
+uint32_t keyword_mix(uint32_t h) noexcept;
@@ -0,0 +1,376 @@
+#include "lexer_dfa.h"
+
+#include <map>
+#include <utility>
+#include <algorithm>
+#include <iostream>
+
+Lexer_Dfa_Limit_Exception::Lexer_Dfa_Limit_Exception(size_t token) noexcept : m_token(token) {}
+const char* Lexer_Dfa_Limit_Exception::what() const noexcept { return "lexer dfa went over the construction limit"; }
+size_t Lexer_Dfa_Limit_Exception::token() const noexcept { return m_token; }
+
+Lexer_Dfa::Lexer_Dfa(const insert_order_map<std::string, token_data>& token_map,
+	const std::vector<bool>& excluded, const construction_limit& limit) :
+	Lexer_Dfa(token_map, std::vector<std::vector<bool>>{excluded}, limit)
+{}
+
+Lexer_Dfa::Lexer_Dfa(const insert_order_map<std::string, token_data>& token_map,
+	const std::vector<std::vector<bool>>& excluded, const construction_limit& limit) : m_states(), m_starts()
+{
+	//tokens simulated outside the lexer dfa may have no dfa, they have to be excluded
+	std::vector<const Dfa*> dfas;
+	for(const auto& [k, v] : token_map) dfas.push_back(std::get_if<Dfa>(&v.regex));
+	
+	//each lexer state is the tuple of the states of every token dfa
+	std::map<std::vector<size_t>, size_t> ids;
+	std::vector<const std::vector<size_t>*> tuples;
+	size_t bytes = 0;
+	auto get_state = [&](std::vector<size_t>&& tuple)
+	{
+		auto [it, did_insert] = ids.emplace(std::move(tuple), m_states.size());
+		if(did_insert)
+		{
+			bytes += sizeof(state)+sizeof(void*)+construction_limit::node_bytes+it->first.size()*sizeof(size_t);
+			tuples.push_back(&it->first);
+			state& s = m_states.emplace_back();
+			s.token = no_token;
+			for(size_t i = 0; i < dfas.size(); i++)
+			{
+				size_t ds = it->first[i];
+				if(ds != Dfa::no_state && dfas[i]->states()[ds].is_accepting)
+				{
+					s.token = i;
+					break;
+				}
+			}
+		}
+		return it->second;
+	};
+	get_state(std::vector<size_t>(dfas.size(), Dfa::no_state)); //dead_state
+	for(const std::vector<bool>& ex : excluded)
+	{
+		std::vector<size_t> start(dfas.size(), 0);
+		for(size_t i = 0; i < ex.size(); i++)
+		{
+			if(ex[i]) start[i] = Dfa::no_state;
+		}
+		size_t s = get_state(std::move(start));
+		if(s == dead_state)
+		{
+			//every token is excluded, the start tuple is the dead one but still needs its own row
+			s = m_states.size();
+			m_states.emplace_back().token = no_token;
+			tuples.push_back(tuples[dead_state]);
+		}
+		m_starts.push_back(s);
+	}
+	m_states[dead_state].transitions.fill(dead_state);
+	for(size_t i = start_state; i < m_states.size(); i++)
+	{
+		if(limit.exceeded(m_states.size(), bytes))
+		{
+			//blame the token whose dfa contributed the most distinct states to the tuples
+			size_t worst = 0, worst_count = 0;
+			for(size_t d = 0; d < dfas.size(); d++)
+			{
+				std::vector<bool> seen(dfas[d] ? dfas[d]->states().size() : 0, false);
+				size_t count = 0;
+				for(const std::vector<size_t>* t : tuples)
+				{
+					size_t ds = (*t)[d];
+					if(ds != Dfa::no_state && !seen[ds])
+					{
+						seen[ds] = true;
+						count++;
+					}
+				}
+				if(count > worst_count)
+				{
+					worst = d;
+					worst_count = count;
+				}
+			}
+			throw Lexer_Dfa_Limit_Exception(worst);
+		}
+		std::array<size_t, 256> transitions;
+		for(unsigned int ch = 0; ch < 256; ch++)
+		{
+			std::vector<size_t> next(dfas.size());
+			for(size_t d = 0; d < dfas.size(); d++)
+			{
+				size_t ds = (*tuples[i])[d];
+				next[d] = ds == Dfa::no_state ? Dfa::no_state : dfas[d]->transition(ds, static_cast<char>(ch));
+			}
+			transitions[ch] = get_state(std::move(next));
+		}
+		m_states[i].transitions = transitions;
+	}
+	prune();
+	minimize();
+}
+
+void Lexer_Dfa::prune()
+{
+	//reverse reachability from the accepting states
+	std::vector<std::vector<size_t>> sources(m_states.size());
+	for(size_t i = start_state; i < m_states.size(); i++)
+	{
+		for(size_t t : m_states[i].transitions) sources[t].push_back(i);
+	}
+	std::vector<bool> live(m_states.size(), false);
+	std::vector<size_t> stack;
+	for(size_t i = start_state; i < m_states.size(); i++)
+	{
+		if(m_states[i].token != no_token)
+		{
+			live[i] = true;
+			stack.push_back(i);
+		}
+	}
+	while(!stack.empty())
+	{
+		size_t s = stack.back();
+		stack.pop_back();
+		for(size_t src : sources[s])
+		{
+			if(!live[src])
+			{
+				live[src] = true;
+				stack.push_back(src);
+			}
+		}
+	}
+	live[dead_state] = true;
+	for(size_t s : m_starts) live[s] = true;
+	for(state& s : m_states)
+	{
+		for(size_t& t : s.transitions)
+		{
+			if(!live[t]) t = dead_state;
+		}
+	}
+	//keep what is still reachable from the start states, in the same order
+	std::vector<bool> reached(m_states.size(), false);
+	reached[dead_state] = true;
+	for(size_t s : m_starts)
+	{
+		if(!reached[s]) stack.push_back(s);
+		reached[s] = true;
+	}
+	while(!stack.empty())
+	{
+		size_t s = stack.back();
+		stack.pop_back();
+		for(size_t t : m_states[s].transitions)
+		{
+			if(!reached[t])
+			{
+				reached[t] = true;
+				stack.push_back(t);
+			}
+		}
+	}
+	std::vector<size_t> number(m_states.size(), dead_state);
+	size_t count = 0;
+	for(size_t i = 0; i < m_states.size(); i++)
+	{
+		if(reached[i]) number[i] = count++;
+	}
+	if(count == m_states.size()) return;
+#ifdef DEBUG
+	std::cout << "debug: pruned " << m_states.size()-count << " lexer dfa states\n";
+#endif
+	std::vector<state> kept;
+	kept.reserve(count);
+	for(size_t i = 0; i < m_states.size(); i++)
+	{
+		if(!reached[i]) continue;
+		state& s = kept.emplace_back(m_states[i]);
+		for(size_t& t : s.transitions) t = number[t];
+	}
+	m_states = std::move(kept);
+	for(size_t& s : m_starts) s = number[s];
+}
+
+void Lexer_Dfa::minimize()
+{
+	//start with states split by accepted token, the dead state is kept on its own
+	std::vector<size_t> cls(m_states.size());
+	size_t class_count;
+	{
+		std::map<size_t, size_t> ids;
+		for(size_t i = start_state; i < m_states.size(); i++)
+		{
+			cls[i] = ids.emplace(m_states[i].token, ids.size()+1).first->second;
+		}
+		cls[dead_state] = 0;
+		class_count = ids.size()+1;
+	}
+	//split classes by the classes of their transitions until nothing changes
+	while(true)
+	{
+		std::map<std::vector<size_t>, size_t> ids;
+		std::vector<size_t> next(m_states.size());
+		for(size_t i = 0; i < m_states.size(); i++)
+		{
+			std::vector<size_t> sig;
+			sig.reserve(257);
+			sig.push_back(cls[i]);
+			for(size_t t : m_states[i].transitions) sig.push_back(cls[t]);
+			next[i] = ids.emplace(std::move(sig), ids.size()).first->second;
+		}
+		cls = std::move(next);
+		if(ids.size() == class_count) break;
+		class_count = ids.size();
+	}
+	if(class_count == m_states.size()) return;
+	//renumber classes in breadth first order from the start states
+	std::vector<size_t> number(class_count, no_token);
+	std::vector<size_t> order = {dead_state};
+	number[cls[dead_state]] = dead_state;
+	for(size_t s : m_starts)
+	{
+		if(number[cls[s]] != no_token) continue;
+		number[cls[s]] = order.size();
+		order.push_back(s);
+	}
+	for(size_t i = 1; i < order.size(); i++)
+	{
+		for(size_t t : m_states[order[i]].transitions)
+		{
+			if(number[cls[t]] == no_token)
+			{
+				number[cls[t]] = order.size();
+				order.push_back(t);
+			}
+		}
+	}
+	std::vector<state> merged(order.size());
+	for(size_t i = 0; i < order.size(); i++)
+	{
+		merged[i].token = m_states[order[i]].token;
+		for(unsigned int ch = 0; ch < 256; ch++)
+		{
+			merged[i].transitions[ch] = number[cls[m_states[order[i]].transitions[ch]]];
+		}
+	}
+	m_states = std::move(merged);
+	for(size_t& s : m_starts) s = number[cls[s]];
+}
+
+bool Lexer_Dfa::backtrack_free() const noexcept
+{
+	//a start state dying only means no token starts here, unless a token loops back into it
+	std::vector<bool> entered(m_states.size(), false);
+	for(const state& s : m_states)
+	{
+		for(size_t t : s.transitions) entered[t] = true;
+	}
+	//the end of input is a dead transition out of every state, a scan ending in a non
+	//accepting state that comes after an accepting one has to back up to it
+	std::vector<bool> after_accept(m_states.size(), false);
+	std::vector<size_t> stack;
+	for(size_t i = start_state; i < m_states.size(); i++)
+	{
+		if(m_states[i].token != no_token) stack.push_back(i);
+	}
+	while(!stack.empty())
+	{
+		size_t i = stack.back();
+		stack.pop_back();
+		for(size_t t : m_states[i].transitions)
+		{
+			if(t == dead_state || after_accept[t]) continue;
+			after_accept[t] = true;
+			stack.push_back(t);
+		}
+	}
+	for(size_t i = start_state; i < m_states.size(); i++)
+	{
+		if(m_states[i].token != no_token) continue;
+		if(!entered[i] && std::find(m_starts.cbegin(), m_starts.cend(), i) != m_starts.cend()) continue;
+		if(after_accept[i]) return false;
+		for(size_t t : m_states[i].transitions)
+		{
+			if(t == dead_state) return false;
+		}
+	}
+	return true;
+}
+
+std::vector<double> Lexer_Dfa::static_frequency() const
+{
+	std::vector<unsigned char> bytes = {'\t', '\n', '\r'};
+	for(unsigned char ch = ' '; ch < 127; ch++) bytes.push_back(ch);
+	const double p = 1.0/bytes.size();
+	//power iteration on the markov chain of the scan, a little mass restarts at the start
+	//state every round so states no input reaches still converge
+	std::vector<double> freq(m_states.size(), 0.0);
+	freq[start_state] = 1.0;
+	for(unsigned int round = 0; round < 64; round++)
+	{
+		std::vector<double> next(m_states.size(), 0.0);
+		for(size_t s : m_starts) next[s] += 0.05/static_cast<double>(m_starts.size());
+		for(size_t i = start_state; i < m_states.size(); i++)
+		{
+			if(freq[i] == 0.0) continue;
+			for(unsigned char ch : bytes)
+			{
+				size_t t = m_states[i].transitions[ch];
+				if(t == dead_state) t = m_states[start_state].transitions[ch];
+				if(t == dead_state) t = start_state;
+				next[t] += 0.95*p*freq[i];
+			}
+		}
+		freq = std::move(next);
+	}
+	return freq;
+}
+
+std::vector<size_t> Lexer_Dfa::reorder(const std::vector<double>& frequency)
+{
+	std::vector<size_t> order;
+	for(size_t i = start_state+1; i < m_states.size(); i++) order.push_back(i);
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b){ return frequency[a] > frequency[b]; });
+	order.insert(order.begin(), {dead_state, start_state});
+	std::vector<size_t> number(m_states.size());
+	for(size_t i = 0; i < order.size(); i++) number[order[i]] = i;
+	std::vector<state> reordered(m_states.size());
+	for(size_t i = 0; i < order.size(); i++)
+	{
+		reordered[i].token = m_states[order[i]].token;
+		for(unsigned int ch = 0; ch < 256; ch++)
+		{
+			reordered[i].transitions[ch] = number[m_states[order[i]].transitions[ch]];
+		}
+	}
+	m_states = std::move(reordered);
+	for(size_t& s : m_starts) s = number[s];
+	return number;
+}
+
+Lexer_Dfa::operator const std::vector<Lexer_Dfa::state>&() const noexcept { return m_states; }
+const std::vector<Lexer_Dfa::state>& Lexer_Dfa::states() const noexcept { return m_states; }
+size_t Lexer_Dfa::start(size_t condition) const noexcept { return m_starts[condition]; }
+const std::vector<size_t>& Lexer_Dfa::starts() const noexcept { return m_starts; }
+
+std::ostream& operator<<(std::ostream& os, const Lexer_Dfa& dfa)
+{
+	const std::vector<Lexer_Dfa::state>& states = dfa;
+	for(size_t i = 0; i < states.size(); i++)
+	{
+		os << i << '\t';
+		bool first = true;
+		for(unsigned int ch = 0; ch < 256; ch++)
+		{
+			size_t t = states[i].transitions[ch];
+			if(t == Lexer_Dfa::dead_state) continue;
+			if(!first) os << ", ";
+			os << static_cast<char>(ch) << "→" << t;
+			first = false;
+		}
+		if(states[i].token != Lexer_Dfa::no_token) os << " Accepting " << states[i].token;
+		if(i+1 < states.size()) os << '\n';
+	}
+	return os;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "input_parse.h"
+#include "insert_order_map.h"
+
+#include <array>
+#include <vector>
+#include <string>
+#include <ostream>
+#include <exception>
+
+//thrown when the product construction goes over its limit
+class Lexer_Dfa_Limit_Exception : public std::exception
+{
+public:
+	Lexer_Dfa_Limit_Exception(size_t token) noexcept;
+	const char* what() const noexcept override;
+	//index of the token whose dfa contributed the most distinct states to the product
+	size_t token() const noexcept;
+private:
+	size_t m_token;
+};
+
+//the automaton of the whole lexer, the product of the dfas of every token
+//each state accepts the earliest token in insertion order that any of its parts accepts
+class Lexer_Dfa
+{
+public:
+	
+	static constexpr size_t no_token = static_cast<size_t>(-1);
+	static constexpr size_t dead_state = 0;
+	static constexpr size_t start_state = 1;
+	
+	struct state
+	{
+		size_t token; //index of the accepted token in the token map or no_token
+		std::array<size_t, 256> transitions; //indexed by unsigned byte
+	};
+	
+	//tokens flagged in excluded (if not empty) are left out of the automaton, throws
+	//Lexer_Dfa_Limit_Exception if the product construction goes over limit
+	Lexer_Dfa(const insert_order_map<std::string, token_data>& token_map,
+		const std::vector<bool>& excluded = {}, const construction_limit& limit = {});
+	//one start state per start condition sharing the other states, condition c leaves out the
+	//tokens flagged in excluded[c] (if not empty) and starts at start(c), start(0) is start_state
+	Lexer_Dfa(const insert_order_map<std::string, token_data>& token_map,
+		const std::vector<std::vector<bool>>& excluded, const construction_limit& limit);
+	
+	operator const std::vector<state>&() const noexcept;
+	const std::vector<state>& states() const noexcept;
+	size_t start(size_t condition) const noexcept;
+	const std::vector<size_t>& starts() const noexcept;
+	
+	//true if maximal munch never has to go back to an earlier accepting state, every
+	//state that dies on some byte is accepting (or a start state before any input) and
+	//so is every state after an accepting one, since the input can end in it
+	bool backtrack_free() const noexcept;
+	
+	//estimated share of a scan spent in each state, for input bytes spread evenly over printable
+	//ascii and whitespace, a dying state ends its token and the next byte starts from start_state
+	std::vector<double> static_frequency() const;
+	
+	//renumbers the states by descending frequency so the rows scanned most share cache lines,
+	//dead_state and start_state keep their numbers, returns the new number of each old state
+	//(the other start states are renumbered with the rest)
+	std::vector<size_t> reorder(const std::vector<double>& frequency);
+private:
+	std::vector<state> m_states;
+	std::vector<size_t> m_starts; //start state of each start condition
+	
+	//redirects every transition into a state that can't reach an accepting state to dead_state,
+	//the shared error sink a failed scan stops at, and drops states no longer reachable
+	void prune();
+	
+	//merges equivalent states (moore's algorithm), keeps dead_state and start_state in place
+	void minimize();
+};
+
+std::ostream& operator<<(std::ostream& os, const Lexer_Dfa& dfa);
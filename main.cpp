@@ -1,15 +1,151 @@
 #include "input_parse.h"
 #include "insert_order_map.h"
+#include "lexer_dfa.h"
+#include "keywords.h"
+#include "codegen.h"
+#include "profile.h"
+#include "verify.h"
 
-#ifdef DEBUG
 #include <iostream>
+#include <fstream>
+#include <optional>
+
+#ifndef REC_FUZZ //libfuzzer brings its own main
+//builds the product of the token dfas under --max-dfa-states and --max-memory, with
+//--dfa-budget the token blamed for going over is simulated on its dfa as an nfa instead
+//each start condition gets its own start state, leaving out the tokens not active in it
+static Lexer_Dfa build_lexer_dfa(insert_order_map<std::string, token_data>& token_map,
+	std::vector<bool>& excluded, const options& opts)
+{
+	construction_limit limit;
+	if(opts.max_dfa_states != 0) limit.max_states = opts.max_dfa_states;
+	if(opts.max_memory != 0) limit.max_bytes = opts.max_memory;
+	std::vector<std::string> conditions = start_conditions(token_map);
+	while(true)
+	{
+		std::vector<std::vector<bool>> condition_excluded(conditions.size(), excluded);
+		for(size_t c = 0; c < conditions.size(); c++)
+		{
+			condition_excluded[c].resize(token_map.size(), false);
+			size_t i = 0;
+			for(const auto& [k, v] : token_map)
+			{
+				if(!active_in(v, conditions[c])) condition_excluded[c][i] = true;
+				i++;
+			}
+		}
+		try
+		{
+			return Lexer_Dfa(token_map, condition_excluded, limit);
+		}catch(const Lexer_Dfa_Limit_Exception& e)
+		{
+			auto it = token_map.begin()+static_cast<std::ptrdiff_t>(e.token());
+			excluded.resize(token_map.size(), false);
+			if(opts.dfa_budget == 0 || excluded[e.token()])
+			{
+				std::cerr << "error: lexer dfa went over the limit (" << describe_limits(opts);
+				std::cerr << "), most of its states come from token '" << it->first << "'\n";
+				if(opts.dfa_budget == 0) std::cerr << "note: with --dfa-budget that token is simulated instead of failing\n";
+				std::exit(4);
+			}
+#ifdef DEBUG
+			std::cout << "debug: lexer dfa went over the limit, simulating token '" << it->first << "' on its own\n";
+#endif
+			it->second.nfa_fallback.emplace(std::get<Dfa>(it->second.regex));
+			excluded[e.token()] = true;
+		}
+	}
+}
+
+//generates the lexer of one spec into output (stdout when null), returns the exit code
+static int generate(insert_order_map<std::string, token_data>& token_map, const options& opts,
+	const std::optional<std::string>& corpus, const char* output)
+{
+	std::vector<keyword> keywords;
+	std::vector<bool> excluded;
+	if(opts.keyword_split)
+	{
+		keywords = find_keywords(token_map);
+		excluded.resize(token_map.size(), false);
+		for(const keyword& k : keywords) excluded[k.token] = true;
+#ifdef DEBUG
+		std::cout << "debug: " << keywords.size() << " keywords split from the lexer dfa\n";
+#endif
+	}
+	if(opts.bit_parallel || opts.dfa_budget != 0)
+	{
+		excluded.resize(token_map.size(), false);
+		size_t i = 0;
+		for(const auto& [k, v] : token_map)
+		{
+			if(v.bit_parallel || v.nfa_fallback) excluded[i] = true;
+			i++;
+		}
+	}
+	Lexer_Dfa lexer_dfa = build_lexer_dfa(token_map, excluded, opts);
+	std::optional<dfa_profile> profile;
+	if(corpus)
+	{
+		profile = profile_dfa(lexer_dfa, *corpus, condition_switches(token_map));
+		profile->renumber(lexer_dfa.reorder(profile->frequency()));
+#ifdef DEBUG
+		std::cout << "debug: profiled " << profile->dead_hits << " dead transitions, ";
+		std::cout << profile->accept_hits << " accepting states entered\n";
+#endif
+	}else
+	{
+		lexer_dfa.reorder(lexer_dfa.static_frequency());
+	}
+#ifdef DEBUG
+	std::cout << "debug: lexer dfa\n" << lexer_dfa << '\n';
 #endif
+	keyword_table keyword_tbl = build_keyword_table(std::move(keywords));
+	if(output != nullptr) //output file
+	{
+		std::ofstream file(output);
+		if(!file.is_open())
+		{
+			std::cerr << "error: could not open output file: " << output << '\n';
+			return 1;
+		}
+		generate_lexer(file, token_map, lexer_dfa, keyword_tbl, profile ? &*profile : nullptr);
+	}else
+	{
+		generate_lexer(std::cout, token_map, lexer_dfa, keyword_tbl, profile ? &*profile : nullptr);
+	}
+	return 0;
+}
 
 int main(int argc, const char** argv)
 {
-	insert_order_map<std::string, token_data> token_map = parse_input(argc, argv);
+	options opts = parse_args(argc, argv);
+	if(opts.verify_seed) return run_verify(*opts.verify_seed, 1000) == 0 ? 0 : 3;
+	if(opts.verify_codegen_seed)
+	{
+		size_t failed = run_verify_codegen(*opts.verify_codegen_seed, 50, [](const options& spec_opts)
+		{
+			insert_order_map<std::string, token_data> token_map = parse_input(spec_opts);
+			if(int code = generate(token_map, spec_opts, std::nullopt, spec_opts.output)) std::exit(code);
+		});
+		return failed == 0 ? 0 : 3;
+	}
+	std::optional<std::string> corpus;
+	if(opts.profile_corpus != nullptr) corpus = read_corpus(opts.profile_corpus);
+	if(!opts.batch.empty())
+	{
+		std::vector<insert_order_map<std::string, token_data>> specs = parse_batch(opts);
+		for(size_t i = 0; i < specs.size(); i++)
+		{
+			if(int code = generate(specs[i], opts, corpus, opts.batch[i].second)) return code;
+		}
+	}else
+	{
+		insert_order_map<std::string, token_data> token_map = parse_input(opts);
+		if(int code = generate(token_map, opts, corpus, opts.output)) return code;
+	}
 #ifdef DEBUG
 	std::cout << "debug: program completed successfully\n";
 #endif
 	return 0;
 }
+#endif
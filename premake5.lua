@@ -1,5 +1,5 @@
 workspace "rec"
-	configurations {"debug", "release"}
+	configurations {"debug", "release", "fuzz"}
 project "rec"
 	kind "ConsoleApp"
 	language "C++"
@@ -15,5 +15,13 @@ project "rec"
 	filter "configurations:release"
 		defines { "NDEBUG" }
 		optimize "On"
+	filter "configurations:fuzz"
+		defines { "NDEBUG", "REC_FUZZ" }
+		symbols "On"
+		optimize "On"
+		buildoptions {"-fsanitize=fuzzer,address"}
+		linkoptions {"-fsanitize=fuzzer,address"}
 	filter { "system:linux", "action:gmake2" }
-		buildoptions {"-Wnrvo"}
\ No newline at end of file
+		buildoptions {"-Wnrvo"}
+	filter "system:linux"
+		links {"pthread"}
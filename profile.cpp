@@ -0,0 +1,78 @@
+#include "profile.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <utility>
+
+std::vector<double> dfa_profile::frequency() const
+{
+	return std::vector<double>(state_hits.cbegin(), state_hits.cend());
+}
+
+void dfa_profile::renumber(const std::vector<size_t>& number)
+{
+	std::vector<size_t> states(state_hits.size());
+	std::vector<std::array<size_t, 256>> transitions(transition_hits.size());
+	for(size_t i = 0; i < number.size(); i++)
+	{
+		states[number[i]] = state_hits[i];
+		transitions[number[i]] = transition_hits[i];
+	}
+	state_hits = std::move(states);
+	transition_hits = std::move(transitions);
+}
+
+dfa_profile profile_dfa(const Lexer_Dfa& dfa, std::string_view input, const std::vector<size_t>& switches)
+{
+	const std::vector<Lexer_Dfa::state>& states = dfa;
+	dfa_profile ret;
+	ret.state_hits.resize(states.size(), 0);
+	ret.transition_hits.resize(states.size());
+	for(std::array<size_t, 256>& t : ret.transition_hits) t.fill(0);
+	size_t pos = 0, condition = 0;
+	while(pos < input.size())
+	{
+		size_t s = dfa.start(condition);
+		size_t end = pos+1, token = Lexer_Dfa::no_token;
+		ret.state_hits[s]++;
+		for(size_t i = pos; i < input.size(); i++)
+		{
+			unsigned char ch = static_cast<unsigned char>(input[i]);
+			ret.transition_hits[s][ch]++;
+			s = states[s].transitions[ch];
+			if(s == Lexer_Dfa::dead_state)
+			{
+				ret.dead_hits++;
+				break;
+			}
+			ret.state_hits[s]++;
+			if(states[s].token != Lexer_Dfa::no_token)
+			{
+				ret.accept_hits++;
+				end = i+1;
+				token = states[s].token;
+			}
+		}
+		pos = end;
+		if(token != Lexer_Dfa::no_token && token < switches.size() && switches[token] != no_condition) condition = switches[token];
+	}
+	return ret;
+}
+
+std::string read_corpus(const char* path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if(!file.is_open())
+	{
+		std::cerr << "error: could not open profile corpus: " << path << '\n';
+		std::cerr << std::strerror(errno) << '\n';
+		std::exit(1);
+	}
+	std::ostringstream ss;
+	ss << file.rdbuf();
+	return ss.str();
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "lexer_dfa.h"
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//hit counts of the lexer dfa scanning a sample input the way the generated rec_next does,
+//including the bytes scanned past the end of a token before maximal munch backs up
+struct dfa_profile
+{
+	std::vector<size_t> state_hits; //times each state was entered
+	std::vector<std::array<size_t, 256>> transition_hits; //indexed by state and unsigned byte
+	size_t accept_hits = 0; //times the state entered was accepting
+	size_t dead_hits = 0; //times a scan died
+
+	std::vector<double> frequency() const;
+	//number[old] is the new index of each state after Lexer_Dfa::reorder
+	void renumber(const std::vector<size_t>& number);
+};
+
+//switches[token] (if not empty) is the start condition the scan goes on in after the token
+dfa_profile profile_dfa(const Lexer_Dfa& dfa, std::string_view input, const std::vector<size_t>& switches = {});
+
+//reads the whole sample input, exits on failure
+std::string read_corpus(const char* path);
@@ -0,0 +1,535 @@
+#include "regex_ast.h"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <functional>
+#include <tuple>
+
+Regex_Exception::Regex_Exception(const char* what) noexcept : m_what(what) {}
+Regex_Exception::Regex_Exception(const Regex_Exception& oth) noexcept : m_what(oth.m_what) {}
+Regex_Exception& Regex_Exception::operator=(const Regex_Exception& oth) noexcept
+{
+	m_what = oth.m_what;
+	return *this;
+}
+const char* Regex_Exception::what() const noexcept { return m_what; }
+
+static unsigned int lex_number(std::string_view& str)
+{
+	if(str.empty()) throw Regex_Exception("encountered end of string too early");
+	unsigned int number = 0;
+	char ch = str.front();
+	if(!(ch >= '0' && ch <= '9')) throw Regex_Exception("failed to read number expected digit");
+	do
+	{
+		number *= 10;
+		number += static_cast<unsigned int>(ch-'0');
+		str.remove_prefix(1);
+		if(str.empty()) throw Regex_Exception("encountered end of string too early");
+		ch = str.front();
+	}while(ch >= '0' && ch <= '9');
+	return number;
+}
+
+//translates the character following the escape character '/' into the character it
+//stands for, does not handle the character classes /s and /S
+static char escaped_char(char ch)
+{
+	switch(ch)
+	{
+	default: return ch;
+	case 'n':
+	case 'N': return '\n';
+	case 't':
+	case 'T': return '\t';
+	case 'r':
+	case 'R': return '\r';
+	case 'v':
+	case 'V': return '\v';
+	case 'f':
+	case 'F': return '\f';
+	case 'a':
+	case 'A': return '\a';
+	case 'b':
+	case 'B': return '\b';
+	case 'z':
+	case 'Z': return 0;
+	}
+}
+
+bool regex_literal(std::string_view regex, std::string& out)
+{
+	std::string lit;
+	while(!regex.empty())
+	{
+		char ch = regex.front();
+		regex.remove_prefix(1);
+		switch(ch)
+		{
+		default: lit += ch; break;
+		case '/':
+			if(regex.empty()) return false;
+			ch = regex.front();
+			regex.remove_prefix(1);
+			if(ch == 's' || ch == 'S') return false;
+			lit += escaped_char(ch);
+			break;
+		case '.':
+		case '(':
+		case ')':
+		case '|':
+		case '[':
+		case ']':
+		case '*':
+		case '+':
+		case '?':
+		case '-':
+		case '{':
+		case '}': return false;
+		}
+	}
+	if(lit.empty()) return false;
+	out = std::move(lit);
+	return true;
+}
+
+bool has_letter(std::string_view str) noexcept
+{
+	for(char ch : str)
+	{
+		if((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z')) return true;
+	}
+	return false;
+}
+
+/* regex cfg
+S  -> G S' $
+S' -> pipe S | eps
+G  -> U O G | eps
+U  -> ch | . | ( S ) | (? S ) | (?= S ) $ | A
+O -> * | + | ? | { I N } | eps
+A  -> [ ch - ch A' ]
+A' -> ch - ch A' | eps
+I -> digit I'
+I' -> digit I' | eps
+N -> - I | + | eps
+*/
+
+
+bool Regex_Ast::node::operator==(const node& oth) const noexcept
+{
+	return type == oth.type && set == oth.set && children == oth.children
+		&& min == oth.min && max == oth.max;
+}
+
+size_t Regex_Ast::node_hash::operator()(const node& n) const noexcept
+{
+	size_t h = std::hash<std::bitset<256>>()(n.set);
+	auto combine = [&h](size_t v){ h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2); };
+	combine(static_cast<size_t>(n.type));
+	for(size_t c : n.children) combine(c);
+	combine(n.min);
+	combine(n.max);
+	return h;
+}
+
+Regex_Ast::Regex_Ast(std::string_view regex, bool fold_case) :
+	m_nodes(), m_ids(), m_root(0), m_head(0), m_trail(no_node), m_groups(0), m_depth(0), m_fold_case(fold_case)
+{
+	m_head = parse_regex(regex);
+	if(!regex.empty())
+	{
+		throw Regex_Exception("string not empty at end of parse");
+	}
+	m_root = m_head;
+	if(m_trail == no_node) return;
+	//the scan matches head and context as one and the lexeme is cut off afterwards, which
+	//needs one side to have a known length
+	auto [hmin, hmax] = length_bounds(m_head);
+	auto [tmin, tmax] = length_bounds(m_trail);
+	if(hmin == 0) throw Regex_Exception("the regex before trailing context can't match the empty string");
+	if(hmin != hmax && tmin != tmax) throw Regex_Exception("trailing context needs a fixed length regex before or inside '(?=)'");
+	m_root = make_concat({m_head, m_trail});
+}
+
+Regex_Ast::operator const std::vector<Regex_Ast::node>&() const noexcept { return m_nodes; }
+const std::vector<Regex_Ast::node>& Regex_Ast::nodes() const noexcept { return m_nodes; }
+size_t Regex_Ast::root() const noexcept { return m_root; }
+size_t Regex_Ast::groups() const noexcept { return m_groups; }
+size_t Regex_Ast::head() const noexcept { return m_head; }
+size_t Regex_Ast::trail() const noexcept { return m_trail; }
+
+std::pair<size_t, size_t> Regex_Ast::length_bounds(size_t n) const noexcept
+{
+	static constexpr size_t unbounded_length = std::numeric_limits<size_t>::max();
+	auto add = [](size_t a, size_t b){ return a >= unbounded_length-b ? unbounded_length : a+b; };
+	const node& nd = m_nodes[n];
+	switch(nd.type)
+	{
+	default:
+	case node_type::empty: return {0, 0};
+	case node_type::set: return {1, 1};
+	case node_type::capture: return length_bounds(nd.children[0]);
+	case node_type::concat:
+	{
+		std::pair<size_t, size_t> ret{0, 0};
+		for(size_t c : nd.children)
+		{
+			auto [cmin, cmax] = length_bounds(c);
+			ret = {add(ret.first, cmin), add(ret.second, cmax)};
+		}
+		return ret;
+	}
+	case node_type::alt:
+	{
+		std::pair<size_t, size_t> ret{unbounded_length, 0};
+		for(size_t c : nd.children)
+		{
+			auto [cmin, cmax] = length_bounds(c);
+			ret = {std::min(ret.first, cmin), std::max(ret.second, cmax)};
+		}
+		return ret;
+	}
+	case node_type::repeat:
+	{
+		auto [cmin, cmax] = length_bounds(nd.children[0]);
+		auto times = [&](size_t len, unsigned int count)
+		{
+			if(len == 0) return size_t(0);
+			if(count == unbounded || len > unbounded_length/count) return unbounded_length;
+			return len*count;
+		};
+		return {times(cmin, nd.min), times(cmax, nd.max)};
+	}
+	}
+}
+
+size_t Regex_Ast::intern(node&& n)
+{
+	auto it = m_ids.find(n);
+	if(it != m_ids.end()) return it->second;
+	size_t ret = m_nodes.size();
+	m_ids.emplace(n, ret);
+	m_nodes.push_back(std::move(n));
+	return ret;
+}
+
+size_t Regex_Ast::make_empty()
+{
+	return intern({node_type::empty, {}, {}, 0, 0});
+}
+
+size_t Regex_Ast::make_set(const std::bitset<256>& set)
+{
+	if(!m_fold_case) return intern({node_type::set, set, {}, 0, 0});
+	std::bitset<256> folded = set;
+	for(unsigned int c = 'a'; c <= 'z'; c++)
+	{
+		if(set[c] || set[c-'a'+'A']) folded.set(c).set(c-'a'+'A');
+	}
+	return intern({node_type::set, folded, {}, 0, 0});
+}
+
+size_t Regex_Ast::make_concat(std::vector<size_t> children)
+{
+	std::vector<size_t> flat;
+	for(size_t c : children)
+	{
+		switch(m_nodes[c].type)
+		{
+		default: flat.push_back(c); break;
+		case node_type::empty: break;
+		case node_type::concat:
+			flat.insert(flat.end(), m_nodes[c].children.cbegin(), m_nodes[c].children.cend());
+			break;
+		}
+	}
+	//adjacent repeats of the same subtree add up, x{a-b}x{c-d} is x{a+c - b+d}, x*x* is x*
+	std::vector<size_t> merged;
+	for(size_t c : flat)
+	{
+		if(!merged.empty())
+		{
+			auto parts = [this](size_t i)
+			{
+				const node& n = m_nodes[i];
+				if(n.type == node_type::repeat) return std::make_tuple(n.children[0], n.min, n.max);
+				return std::make_tuple(i, 1u, 1u);
+			};
+			auto [bx, bmin, bmax] = parts(merged.back());
+			auto [cx, cmin, cmax] = parts(c);
+			if(bx == cx && bmin < unbounded-cmin)
+			{
+				unsigned int max = bmax == unbounded || cmax == unbounded || bmax >= unbounded-cmax
+					? unbounded : bmax+cmax;
+				merged.back() = make_repeat(bx, bmin+cmin, max);
+				continue;
+			}
+		}
+		merged.push_back(c);
+	}
+	if(merged.empty()) return make_empty();
+	if(merged.size() == 1) return merged.front();
+	return intern({node_type::concat, {}, std::move(merged), 0, 0});
+}
+
+size_t Regex_Ast::make_alt(std::vector<size_t> children)
+{
+	std::vector<size_t> flat;
+	bool optional = false;
+	for(size_t c : children)
+	{
+		switch(m_nodes[c].type)
+		{
+		default: flat.push_back(c); break;
+		case node_type::empty: optional = true; break;
+		case node_type::alt:
+			flat.insert(flat.end(), m_nodes[c].children.cbegin(), m_nodes[c].children.cend());
+			break;
+		}
+	}
+	//factor out common prefixes, abc|abd is ab(c|d)
+	std::map<size_t, std::vector<size_t>> groups;
+	std::vector<size_t> firsts;
+	for(size_t c : flat)
+	{
+		size_t first = m_nodes[c].type == node_type::concat ? m_nodes[c].children.front() : c;
+		auto [it, did_insert] = groups.emplace(first, std::vector<size_t>());
+		if(did_insert) firsts.push_back(first);
+		it->second.push_back(c);
+	}
+	std::vector<size_t> factored;
+	std::bitset<256> set;
+	bool has_set = false;
+	for(size_t first : firsts)
+	{
+		std::vector<size_t>& group = groups[first];
+		size_t f = group.front();
+		if(group.size() > 1)
+		{
+			std::vector<size_t> rests;
+			for(size_t c : group)
+			{
+				if(m_nodes[c].type == node_type::concat)
+				{
+					const std::vector<size_t>& ch = m_nodes[c].children;
+					rests.push_back(make_concat(std::vector<size_t>(ch.cbegin()+1, ch.cend())));
+				}else
+				{
+					rests.push_back(make_empty());
+				}
+			}
+			size_t rest = make_alt(std::move(rests));
+			f = make_concat({first, rest});
+		}
+		//single characters and classes merge into one class
+		if(m_nodes[f].type == node_type::set)
+		{
+			set |= m_nodes[f].set;
+			has_set = true;
+		}else
+		{
+			factored.push_back(f);
+		}
+	}
+	if(has_set) factored.push_back(make_set(set));
+	std::sort(factored.begin(), factored.end());
+	factored.erase(std::unique(factored.begin(), factored.end()), factored.end());
+	size_t ret;
+	if(factored.empty()) return make_empty();
+	if(factored.size() == 1) ret = factored.front();
+	else ret = intern({node_type::alt, {}, std::move(factored), 0, 0});
+	return optional ? make_repeat(ret, 0, 1) : ret;
+}
+
+size_t Regex_Ast::make_repeat(size_t child, unsigned int min, unsigned int max)
+{
+	if(max == 0 || m_nodes[child].type == node_type::empty) return make_empty();
+	if(min == 1 && max == 1) return child;
+	if(m_nodes[child].type == node_type::repeat)
+	{
+		//nested quantifiers, (x*)+ is x*, (x+){2-3} is x{2+}, (x?){2-3} is x{0-3}
+		const node& c = m_nodes[child];
+		size_t x = c.children[0];
+		unsigned int cmin = c.min;
+		unsigned int cmax = c.max;
+		if(cmin <= 1 && cmax == unbounded) return make_repeat(x, cmin == 0 ? 0 : min, unbounded);
+		if(cmin == 0 && cmax == 1) return make_repeat(x, 0, max);
+		//(x{a-b}){n} is x{na - nb}
+		unsigned long long lmin = static_cast<unsigned long long>(cmin)*min;
+		unsigned long long lmax = static_cast<unsigned long long>(cmax)*max;
+		if(min == max && lmin < unbounded && (cmax == unbounded || lmax < unbounded))
+		{
+			return make_repeat(x, static_cast<unsigned int>(lmin),
+				cmax == unbounded ? unbounded : static_cast<unsigned int>(lmax));
+		}
+	}
+	return intern({node_type::repeat, {}, {child}, min, max});
+}
+
+size_t Regex_Ast::make_capture(size_t child, unsigned int group)
+{
+	//not simplified away even around an empty child, the group still records where it matched
+	return intern({node_type::capture, {}, {child}, group, group});
+}
+
+size_t Regex_Ast::parse_regex(std::string_view& str)
+{
+	std::vector<size_t> alternatives;
+	bool loop = true;
+	while(loop) //loop through all chunks seperated by alternation operator
+	{
+		alternatives.push_back(parse_chunk(str));
+		if(str.empty()) break;
+		switch(str.front())
+		{
+		case ')': loop = false; //intentional fallthrough
+		case '|': str.remove_prefix(1); break;
+		default: throw Regex_Exception("unexpected charachter at end of chunk, expected '|' or ')'");
+		}
+	}
+	return make_alt(std::move(alternatives));
+}
+
+size_t Regex_Ast::parse_chunk(std::string_view& str)
+{
+	std::vector<size_t> elements;
+	while(!str.empty())
+	{
+		if(str.front() == '|' || str.front() == ')') break;
+		size_t element = parse_element(str);
+		if(!str.empty())
+		{
+			switch(str.front())
+			{
+			default: break;
+			case '*':
+				element = make_repeat(element, 0, unbounded);
+				str.remove_prefix(1);
+				break;
+			case '+':
+				element = make_repeat(element, 1, unbounded);
+				str.remove_prefix(1);
+				break;
+			case '?':
+				element = make_repeat(element, 0, 1);
+				str.remove_prefix(1);
+				break;
+			case '{':
+			{
+				str.remove_prefix(1);
+				unsigned int min = lex_number(str);
+				unsigned int max = min;
+				switch(str.front())
+				{
+				default: throw Regex_Exception("encountered unexprected character in '{}' operator");
+				case '+':
+					max = unbounded;
+					str.remove_prefix(1);
+					if(str.empty() || str.front() != '}') throw Regex_Exception("expected '}' in '{}' operator");
+					str.remove_prefix(1);
+					break;
+				case '}':
+					str.remove_prefix(1);
+					break;
+				case '-':
+					str.remove_prefix(1);
+					max = lex_number(str);
+					if(max <= min) throw Regex_Exception("max is less than or equal to min inside '{}' operator");
+					if(str.front() != '}') throw Regex_Exception("expected '}' in '{}' operator");
+					str.remove_prefix(1);
+				}
+				element = make_repeat(element, min, max);
+			}}
+		}
+		elements.push_back(element);
+	}
+	return make_concat(std::move(elements));
+}
+
+size_t Regex_Ast::parse_element(std::string_view& str)
+{
+	if(str.empty()) throw Regex_Exception("encountered end of string too early");
+	std::bitset<256> set;
+	char ch = str.front();
+	str.remove_prefix(1);
+	switch(ch)
+	{
+	case '.': //any charachter
+		set.set();
+		break;
+	case '/': //escaped charachter
+		if(str.empty()) throw Regex_Exception("encountered end of string too early");
+		ch = str.front();
+		str.remove_prefix(1);
+		switch(ch)
+		{
+		default:
+			set.set(static_cast<unsigned char>(escaped_char(ch)));
+			break;
+		case 'S':
+			set.set('\t');
+			set.set('\v');
+			set.set('\r');
+		case 's':
+			set.set(' ');
+			break;
+		}
+		break;
+	default: //a specific charachter
+		set.set(static_cast<unsigned char>(ch));
+		break;
+	case '(': //regex
+	{
+		size_t ret;
+		m_depth++;
+		if(str.size() >= 2 && str[0] == '?' && str[1] == '=') //trailing context
+		{
+			if(m_depth != 1) throw Regex_Exception("trailing context '(?=)' inside parentheses");
+			str.remove_prefix(2);
+			size_t groups = m_groups;
+			m_trail = parse_regex(str);
+			if(m_groups != groups) throw Regex_Exception("capture group inside trailing context");
+			if(!str.empty()) throw Regex_Exception("trailing context '(?=)' has to end the regex");
+			ret = make_empty();
+		}else if(!str.empty() && str.front() == '?') //capture group
+		{
+			str.remove_prefix(1);
+			unsigned int group = static_cast<unsigned int>(++m_groups);
+			ret = make_capture(parse_regex(str), group);
+		}else
+		{
+			ret = parse_regex(str);
+		}
+		m_depth--;
+		return ret;
+	}
+	case '[': //range of charachters
+		while(true)
+		{
+			if(str.empty()) throw Regex_Exception("encountered end of string too early");
+			if(str.front() == ']') break;
+			unsigned char min = static_cast<unsigned char>(str.front());
+			str.remove_prefix(1);
+			if(str.empty()) throw Regex_Exception("encountered end of string too early");
+			if(str.front() != '-') throw Regex_Exception("'-' required in character range");
+			str.remove_prefix(1);
+			if(str.empty()) throw Regex_Exception("encountered end of string too early");
+			unsigned char max = static_cast<unsigned char>(str.front());
+			str.remove_prefix(1);
+			if(max < min) std::swap(min, max);
+			for(unsigned int c = min; c <= max; c++) set.set(c);
+		}
+		str.remove_prefix(1);
+		break;
+	case '*': throw Regex_Exception("unexpected charachter '*'");
+	case '+': throw Regex_Exception("unexpected charachter '+'");
+	case '-': throw Regex_Exception("unexpected charachter '-'");
+	case '?': throw Regex_Exception("unexpected charachter '?'");
+	case ']': throw Regex_Exception("unexpected charachter ']'");
+	case '{': throw Regex_Exception("unexpected charachter '{'");
+	case '}': throw Regex_Exception("unexpected charachter '}'");
+	}
+	return make_set(set);
+}
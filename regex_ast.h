@@ -0,0 +1,111 @@
+#pragma once
+
+#include <string_view>
+#include <string>
+#include <exception>
+#include <bitset>
+#include <vector>
+#include <unordered_map>
+#include <limits>
+#include <utility>
+
+class Regex_Exception : public std::exception
+{
+public:
+	Regex_Exception(const char* what) noexcept;
+	~Regex_Exception() = default;
+	Regex_Exception(const Regex_Exception& oth) noexcept;
+	Regex_Exception& operator=(const Regex_Exception& oth) noexcept;
+	const char* what() const noexcept override;
+private:
+	const char* m_what;
+};
+
+//syntax tree of a regex, simplified while it is built
+//nodes are hash consed so identical subtrees share one index and compare equal by index
+class Regex_Ast
+{
+public:
+
+	static constexpr unsigned int unbounded = std::numeric_limits<unsigned int>::max();
+
+	enum class node_type
+	{
+		empty, //matches the empty string
+		set, //matches one byte of the set
+		concat,
+		alt,
+		repeat, //child repeated min to max times
+		capture //child, recording where it starts and ends as capture group min
+	};
+
+	struct node
+	{
+		node_type type;
+		std::bitset<256> set; //indexed by unsigned byte
+		std::vector<size_t> children;
+		unsigned int min, max;
+
+		bool operator==(const node& oth) const noexcept;
+	};
+
+	static constexpr size_t no_node = static_cast<size_t>(-1);
+
+	//with fold_case every set matching an ascii letter matches both of its cases, the regex
+	//is folded as it is parsed so the automata built from it are no larger than the lowercase
+	//one's, throws Regex_Exception if the regex is invalid
+	Regex_Ast(std::string_view regex, bool fold_case = false);
+
+	operator const std::vector<node>&() const noexcept;
+	const std::vector<node>& nodes() const noexcept;
+	//the whole regex, trailing context included
+	size_t root() const noexcept;
+	//the regex before the trailing context '(?=...)', the part a token's lexeme is made of
+	size_t head() const noexcept;
+	//the trailing context, no_node if the regex has none
+	size_t trail() const noexcept;
+	//lengths of the shortest and longest string node n matches, size_t's max if there is no longest
+	std::pair<size_t, size_t> length_bounds(size_t n) const noexcept;
+	//number of capture groups, '(?' opens group n+1 after n groups were opened
+	size_t groups() const noexcept;
+private:
+	struct node_hash
+	{
+		size_t operator()(const node& n) const noexcept;
+	};
+
+	std::vector<node> m_nodes;
+	std::unordered_map<node, size_t, node_hash> m_ids;
+	size_t m_root;
+	size_t m_head;
+	size_t m_trail;
+	size_t m_groups;
+	size_t m_depth; //open parentheses around the element being parsed
+	bool m_fold_case;
+
+	//returns the index of the (simplified) node, adding it if no identical node exists
+	size_t intern(node&& n);
+
+	size_t make_empty();
+	size_t make_set(const std::bitset<256>& set);
+	size_t make_concat(std::vector<size_t> children);
+	size_t make_alt(std::vector<size_t> children);
+	size_t make_repeat(size_t child, unsigned int min, unsigned int max);
+	size_t make_capture(size_t child, unsigned int group);
+
+	//recursively parses a regex up to and including the closing ')' or the end of the string
+	size_t parse_regex(std::string_view& str);
+
+	//parses a chunk of a regex, the elements between two '|'
+	size_t parse_chunk(std::string_view& str);
+
+	//parses a single element of a regex without its operator
+	size_t parse_element(std::string_view& str);
+};
+
+//if the regex only matches a single literal string (no operators, ranges or classes)
+//stores the unescaped string in out and returns true
+bool regex_literal(std::string_view regex, std::string& out);
+
+//true if str has an ascii letter, a literal with one isn't a single string once case folded
+bool has_letter(std::string_view str) noexcept;
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+//set of integers below a fixed universe size (briggs and torczon), insertion and lookup are
+//O(1), clearing is O(1) since stale entries of sparse are caught by the check against dense,
+//iterating yields the members in the order they were inserted
+class sparse_set
+{
+public:
+	typedef std::vector<size_t>::const_iterator const_iterator;
+
+	sparse_set(size_t universe) : m_dense(universe), m_sparse(universe), m_count(0) {}
+
+	bool contains(size_t n) const noexcept
+	{
+		size_t i = m_sparse[n];
+		return i < m_count && m_dense[i] == n;
+	}
+	//returns false if n was already in the set
+	bool insert(size_t n) noexcept
+	{
+		if(contains(n)) return false;
+		m_sparse[n] = m_count;
+		m_dense[m_count++] = n;
+		return true;
+	}
+	void clear() noexcept { m_count = 0; }
+	bool empty() const noexcept { return m_count == 0; }
+	size_t size() const noexcept { return m_count; }
+
+	const_iterator begin() const noexcept { return m_dense.cbegin(); }
+	const_iterator end() const noexcept { return m_dense.cbegin()+static_cast<std::ptrdiff_t>(m_count); }
+private:
+	std::vector<size_t> m_dense;
+	std::vector<size_t> m_sparse;
+	size_t m_count;
+};
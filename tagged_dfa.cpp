@@ -0,0 +1,310 @@
+#include "tagged_dfa.h"
+
+#include <map>
+#include <bitset>
+#include <tuple>
+#include <utility>
+
+//thompson nfa state whose epsilon transitions are ordered by priority, the first one is
+//preferred, a state with a tag sets it to the current position when passed through
+struct tagged_state
+{
+	std::bitset<256> set; //bytes leading to next
+	size_t next;
+	std::vector<size_t> epsilon;
+	int tag;
+};
+
+struct tagged_fragment
+{
+	size_t in, out;
+};
+
+//a path through the nfa reaching a kernel state, its registers are those of the origin
+//kernel state with tags set on the way
+struct tagged_thread
+{
+	size_t state, origin;
+	uint64_t tags;
+};
+
+static size_t new_state(std::vector<tagged_state>& nfa, int tag = -1)
+{
+	nfa.push_back({{}, Tagged_Dfa::no_state, {}, tag});
+	return nfa.size()-1;
+}
+
+//thompson construction with counted repeats expanded, every fragment ends in a fresh state
+//without outgoing transitions, loops prefer another iteration over leaving
+static tagged_fragment build(const Regex_Ast& ast, size_t n, std::vector<tagged_state>& nfa)
+{
+	const Regex_Ast::node& node = ast.nodes()[n];
+	switch(node.type)
+	{
+	default:
+	case Regex_Ast::node_type::empty:
+	{
+		size_t s = new_state(nfa);
+		return {s, s};
+	}
+	case Regex_Ast::node_type::set:
+	{
+		size_t in = new_state(nfa);
+		size_t out = new_state(nfa);
+		nfa[in].set = node.set;
+		nfa[in].next = out;
+		return {in, out};
+	}
+	case Regex_Ast::node_type::concat:
+	{
+		tagged_fragment ret = build(ast, node.children.front(), nfa);
+		for(size_t i = 1; i < node.children.size(); i++)
+		{
+			tagged_fragment f = build(ast, node.children[i], nfa);
+			nfa[ret.out].epsilon.push_back(f.in);
+			ret.out = f.out;
+		}
+		return ret;
+	}
+	case Regex_Ast::node_type::alt:
+	{
+		size_t in = new_state(nfa);
+		size_t out = new_state(nfa);
+		for(size_t c : node.children)
+		{
+			tagged_fragment f = build(ast, c, nfa);
+			nfa[in].epsilon.push_back(f.in);
+			nfa[f.out].epsilon.push_back(out);
+		}
+		return {in, out};
+	}
+	case Regex_Ast::node_type::capture:
+	{
+		size_t in = new_state(nfa, static_cast<int>(2*node.min-2));
+		size_t out = new_state(nfa, static_cast<int>(2*node.min-1));
+		tagged_fragment f = build(ast, node.children[0], nfa);
+		nfa[in].epsilon.push_back(f.in);
+		nfa[f.out].epsilon.push_back(out);
+		return {in, out};
+	}
+	case Regex_Ast::node_type::repeat:
+	{
+		size_t child = node.children[0];
+		size_t in = new_state(nfa);
+		size_t out = in;
+		for(unsigned int i = 0; i < node.min; i++)
+		{
+			tagged_fragment f = build(ast, child, nfa);
+			nfa[out].epsilon.push_back(f.in);
+			out = f.out;
+		}
+		if(node.max == Regex_Ast::unbounded)
+		{
+			size_t loop = new_state(nfa);
+			size_t exit = new_state(nfa);
+			nfa[out].epsilon.push_back(loop);
+			tagged_fragment f = build(ast, child, nfa);
+			nfa[loop].epsilon.push_back(f.in);
+			nfa[loop].epsilon.push_back(exit);
+			nfa[f.out].epsilon.push_back(loop);
+			return {in, exit};
+		}
+		//optional copies nest, x{0-2} is (x(x)?)?
+		size_t exit = new_state(nfa);
+		for(unsigned int i = node.min; i < node.max; i++)
+		{
+			tagged_fragment f = build(ast, child, nfa);
+			nfa[out].epsilon.push_back(f.in);
+			nfa[out].epsilon.push_back(exit);
+			out = f.out;
+		}
+		nfa[out].epsilon.push_back(exit);
+		return {in, exit};
+	}
+	}
+}
+
+//appends the kernel states reachable from s over epsilon transitions to out in priority
+//order (a pike vm step), a state reached before by a preferred path is skipped, which also
+//cuts loop iterations that match nothing
+static void closure(const std::vector<tagged_state>& nfa, size_t final, size_t s, size_t origin,
+	std::vector<bool>& visited, std::vector<tagged_thread>& out)
+{
+	std::vector<std::pair<size_t, uint64_t>> stack{{s, 0}};
+	while(!stack.empty())
+	{
+		auto [n, tags] = stack.back();
+		stack.pop_back();
+		if(visited[n]) continue;
+		visited[n] = true;
+		const tagged_state& st = nfa[n];
+		if(st.tag >= 0) tags |= uint64_t(1) << st.tag;
+		if(st.next != Tagged_Dfa::no_state || n == final)
+		{
+			out.push_back({n, origin, tags});
+			continue;
+		}
+		for(auto it = st.epsilon.crbegin(); it != st.epsilon.crend(); ++it) stack.emplace_back(*it, tags);
+	}
+}
+
+bool Tagged_Dfa::op::operator<(const op& oth) const noexcept
+{
+	return std::tie(dst, src, set) < std::tie(oth.dst, oth.src, oth.set);
+}
+
+//subset construction where a dfa state is the ordered list of kernel states the threads are
+//in, the same states in another order are another dfa state since the order is the priority
+Tagged_Dfa::Tagged_Dfa() :
+	m_states(), m_classes(), m_class_count(0), m_op_lists(), m_initial_ops(0), m_groups(0), m_registers(0) {}
+
+Tagged_Dfa::Tagged_Dfa(const Regex_Ast& ast) : Tagged_Dfa()
+{
+	construction(ast, construction_limit{});
+}
+
+std::optional<Tagged_Dfa> Tagged_Dfa::bounded(const Regex_Ast& ast, const construction_limit& limit)
+{
+	Tagged_Dfa ret;
+	if(!ret.construction(ast, limit)) return std::nullopt;
+	return ret;
+}
+
+bool Tagged_Dfa::construction(const Regex_Ast& ast, const construction_limit& limit)
+{
+	m_groups = ast.groups();
+	if(m_groups > max_groups) throw Regex_Exception("more than 32 capture groups in one regex");
+	std::vector<tagged_state> nfa;
+	tagged_fragment root = build(ast, ast.head(), nfa);
+	size_t final = root.out;
+	std::vector<size_t> kernel(nfa.size(), no_state);
+	for(size_t i = 0; i < nfa.size(); i++)
+	{
+		if(nfa[i].next != no_state || i == final) kernel[i] = m_registers++;
+	}
+
+	//bytes in exactly the same sets go to the same states
+	std::map<std::vector<bool>, uint8_t> signatures;
+	std::vector<unsigned char> representative;
+	for(unsigned int b = 0; b < 256; b++)
+	{
+		std::vector<bool> sig;
+		for(const tagged_state& s : nfa)
+		{
+			if(s.next != no_state) sig.push_back(s.set[b]);
+		}
+		auto [it, did_insert] = signatures.emplace(std::move(sig), static_cast<uint8_t>(m_class_count));
+		if(did_insert)
+		{
+			m_class_count++;
+			representative.push_back(static_cast<unsigned char>(b));
+		}
+		m_classes[b] = it->second;
+	}
+
+	size_t bytes = 0;
+	std::map<std::vector<op>, size_t> op_ids;
+	auto intern_ops = [&](const std::vector<tagged_thread>& threads)
+	{
+		std::vector<op> ops;
+		for(const tagged_thread& t : threads) ops.push_back({kernel[t.state], t.origin, t.tags});
+		auto [it, did_insert] = op_ids.emplace(ops, m_op_lists.size());
+		if(did_insert)
+		{
+			bytes += construction_limit::node_bytes+2*ops.size()*sizeof(op);
+			m_op_lists.push_back(std::move(ops));
+		}
+		return it->second;
+	};
+	std::map<std::vector<size_t>, size_t> state_ids;
+	std::vector<std::vector<size_t>> lists;
+	auto intern_state = [&](const std::vector<tagged_thread>& threads)
+	{
+		std::vector<size_t> list;
+		size_t fin = no_state;
+		for(const tagged_thread& t : threads)
+		{
+			list.push_back(t.state);
+			if(t.state == final) fin = kernel[final];
+		}
+		auto [it, did_insert] = state_ids.emplace(list, m_states.size());
+		if(did_insert)
+		{
+			bytes += sizeof(state)+construction_limit::node_bytes+2*list.size()*sizeof(size_t);
+			lists.push_back(std::move(list));
+			m_states.push_back({{}, {}, fin});
+		}
+		return it->second;
+	};
+
+	std::vector<bool> visited(nfa.size());
+	std::vector<tagged_thread> threads;
+	closure(nfa, final, root.in, m_registers, visited, threads);
+	m_initial_ops = intern_ops(threads);
+	intern_state(threads);
+	for(size_t i = 0; i < lists.size(); i++)
+	{
+		if(limit.exceeded(m_states.size(), bytes)) return false;
+		bytes += 2*m_class_count*sizeof(size_t);
+		const std::vector<size_t> list = lists[i];
+		for(size_t c = 0; c < m_class_count; c++)
+		{
+			unsigned char b = representative[c];
+			visited.assign(nfa.size(), false);
+			threads.clear();
+			for(size_t s : list)
+			{
+				if(nfa[s].next != no_state && nfa[s].set[b]) closure(nfa, final, nfa[s].next, kernel[s], visited, threads);
+			}
+			size_t next = no_state, ops = no_state;
+			if(!threads.empty())
+			{
+				ops = intern_ops(threads);
+				next = intern_state(threads);
+			}
+			m_states[i].next.push_back(next);
+			m_states[i].ops.push_back(ops);
+		}
+	}
+	return !limit.exceeded(m_states.size(), bytes);
+}
+
+Tagged_Dfa::operator const std::vector<Tagged_Dfa::state>&() const noexcept { return m_states; }
+const std::vector<Tagged_Dfa::state>& Tagged_Dfa::states() const noexcept { return m_states; }
+const std::array<uint8_t, 256>& Tagged_Dfa::byte_classes() const noexcept { return m_classes; }
+size_t Tagged_Dfa::class_count() const noexcept { return m_class_count; }
+const std::vector<std::vector<Tagged_Dfa::op>>& Tagged_Dfa::op_lists() const noexcept { return m_op_lists; }
+size_t Tagged_Dfa::initial_ops() const noexcept { return m_initial_ops; }
+size_t Tagged_Dfa::groups() const noexcept { return m_groups; }
+size_t Tagged_Dfa::registers() const noexcept { return m_registers; }
+
+//the same loop as the generated rec_captures
+std::vector<size_t> Tagged_Dfa::match(std::string_view str) const
+{
+	size_t tags = 2*m_groups;
+	//one extra register set that is never written, every tag unset
+	std::vector<size_t> cur((m_registers+1)*tags, no_position), next(cur);
+	auto run = [&](size_t list, size_t pos)
+	{
+		for(const op& o : m_op_lists[list])
+		{
+			for(size_t t = 0; t < tags; t++)
+			{
+				next[o.dst*tags+t] = (o.set >> t & 1) ? pos : cur[o.src*tags+t];
+			}
+		}
+		std::swap(cur, next);
+	};
+	run(m_initial_ops, 0);
+	size_t s = 0;
+	for(size_t i = 0; i < str.size(); i++)
+	{
+		size_t c = m_classes[static_cast<unsigned char>(str[i])];
+		if(m_states[s].next[c] == no_state) return {};
+		run(m_states[s].ops[c], i+1);
+		s = m_states[s].next[c];
+	}
+	if(m_states[s].final == no_state) return {};
+	return std::vector<size_t>(cur.cbegin()+static_cast<std::ptrdiff_t>(m_states[s].final*tags),
+		cur.cbegin()+static_cast<std::ptrdiff_t>((m_states[s].final+1)*tags));
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "regex_ast.h"
+#include "dfa.h"
+
+#include <string_view>
+#include <array>
+#include <optional>
+#include <vector>
+#include <cstdint>
+
+//tagged dfa (laurikari) of a regex with capture groups, run over a lexeme the regex matched
+//(without its trailing context) it finds where every group started and ended in one pass
+//group g is the pair of tags 2g-2 (start) and 2g-1 (end), every kernel state of the tagged
+//nfa (one with a byte transition, or the final state) owns a register set with one register
+//per tag and each transition says, for each nfa state it leads to, which register set the
+//values come from and which tags are set to the current position instead
+//when a lexeme can be split more than one way, repeats take as many iterations as they can
+//from left to right, and alternatives are tried in the order of the simplified syntax tree,
+//so ambiguous alternatives pick an unspecified one
+class Tagged_Dfa
+{
+public:
+	static constexpr size_t no_state = static_cast<size_t>(-1);
+	static constexpr size_t no_position = static_cast<size_t>(-1);
+	static constexpr size_t max_groups = 32;
+
+	//new values of the register set of one nfa state
+	struct op
+	{
+		size_t dst;
+		size_t src; //registers() for a set with every tag unset
+		uint64_t set; //bit t set means tag t is set to the position instead of copied
+
+		bool operator<(const op& oth) const noexcept;
+	};
+
+	struct state
+	{
+		std::vector<size_t> next; //indexed by byte class, no_state if the lexeme can't go on
+		std::vector<size_t> ops; //indexed by byte class, the op list run on the transition
+		size_t final; //register set holding the groups if the lexeme ends here or no_state
+	};
+
+	//throws Regex_Exception if the regex has more than max_groups groups
+	Tagged_Dfa(const Regex_Ast& ast);
+	//builds the tagged dfa unless it goes over the limit, it blows up like any subset
+	//construction, and more since the same states in another order are another state
+	static std::optional<Tagged_Dfa> bounded(const Regex_Ast& ast, const construction_limit& limit);
+
+	operator const std::vector<state>&() const noexcept;
+	const std::vector<state>& states() const noexcept;
+
+	//bytes that no transition tells apart share a class
+	const std::array<uint8_t, 256>& byte_classes() const noexcept;
+	size_t class_count() const noexcept;
+	const std::vector<std::vector<op>>& op_lists() const noexcept;
+	//op list run at position 0 before the first byte, state 0 is the state it leads to
+	size_t initial_ops() const noexcept;
+	size_t groups() const noexcept;
+	size_t registers() const noexcept;
+
+	//start and end offset of every group within str, group g at 2g-2 and 2g-1, no_position
+	//for a group that took no part in the match, empty if the regex doesn't match str
+	std::vector<size_t> match(std::string_view str) const;
+private:
+	Tagged_Dfa();
+
+	//returns false if it stopped after going over the limit
+	bool construction(const Regex_Ast& ast, const construction_limit& limit);
+
+	std::vector<state> m_states;
+	std::array<uint8_t, 256> m_classes;
+	size_t m_class_count;
+	std::vector<std::vector<op>> m_op_lists;
+	size_t m_initial_ops;
+	size_t m_groups;
+	size_t m_registers;
+};
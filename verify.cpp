@@ -0,0 +1,866 @@
+#include "verify.h"
+#include "dfa.h"
+#include "tagged_dfa.h"
+#include "regex_ast.h"
+#include "lexer_dfa.h"
+#include "input_parse.h"
+#include "insert_order_map.h"
+
+#include <iostream>
+#include <optional>
+#include <utility>
+#include <iterator>
+#include <functional>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+static constexpr char alphabet[] = "abc ";
+
+static char random_char(std::mt19937& rng)
+{
+	return alphabet[std::uniform_int_distribution<size_t>(0, sizeof(alphabet)-2)(rng)];
+}
+
+std::string random_regex(std::mt19937& rng, unsigned int depth)
+{
+	std::uniform_int_distribution<int> pick(0, 9);
+	int kind = depth == 0 ? 0 : pick(rng);
+	switch(kind)
+	{
+	default: //a single byte or set
+	{
+		static constexpr const char* atoms[] = {"a", "b", "c", "a", "b", ".", "[a-b]", "[c-a]", "/s", "/S"};
+		return atoms[pick(rng)];
+	}
+	case 5:
+	case 6: //concatenation
+		return random_regex(rng, depth-1) + random_regex(rng, depth-1);
+	case 7: //alternation, sometimes a capture group
+		return (pick(rng) < 3 ? "(?" : "(") + random_regex(rng, depth-1) + '|' + random_regex(rng, depth-1) + ')';
+	case 8:
+	case 9: //repetition
+	{
+		static constexpr const char* ops[] = {"*", "+", "?", "{2}", "{0-2}", "{1-3}", "{2+}", "{0+}", "*", "+"};
+		return (pick(rng) < 3 ? "(?" : "(") + random_regex(rng, depth-1) + ')' + ops[pick(rng)];
+	}
+	}
+}
+
+//walks the dfa taking mostly bytes it has a transition for so inputs are often matched
+static std::string random_input(std::mt19937& rng, const Dfa& dfa)
+{
+	const std::vector<Dfa::state>& states = dfa;
+	std::uniform_int_distribution<int> percent(0, 99);
+	std::string ret;
+	size_t s = 0;
+	while(ret.size() < 16 && percent(rng) >= (states[s].is_accepting ? 30 : 8))
+	{
+		char ch = random_char(rng);
+		const std::map<char, size_t>* t = std::get_if<std::map<char, size_t>>(&states[s].transitions);
+		if(t != nullptr && !t->empty() && percent(rng) < 80)
+		{
+			auto it = t->cbegin();
+			std::advance(it, std::uniform_int_distribution<size_t>(0, t->size()-1)(rng));
+			ch = it->first;
+		}
+		ret += ch;
+		s = dfa.transition(s, ch);
+		if(s == Dfa::no_state) break;
+	}
+	return ret;
+}
+
+//input with non printable bytes escaped so a failure can be reproduced from the message
+static std::string printable(std::string_view str)
+{
+	static constexpr char hex[] = "0123456789abcdef";
+	std::string ret;
+	for(char ch : str)
+	{
+		unsigned char c = static_cast<unsigned char>(ch);
+		if(c >= ' ' && c < 127 && c != '\\') ret += ch;
+		else ret += std::string("\\x") + hex[c >> 4] + hex[c & 15];
+	}
+	return ret;
+}
+
+typedef std::function<bool(size_t)> continuation;
+
+//backtracking reference for the tagged dfa, tries the paths of node n in the tagged dfa's
+//priority order and calls k with where each one ends until k accepts, an iteration of an
+//unbounded loop has to consume a byte like the pike vm's loop cut
+static bool backtrack(const Regex_Ast& ast, size_t n, std::string_view str, size_t pos,
+	std::vector<size_t>& tags, const continuation& k)
+{
+	const Regex_Ast::node& node = ast.nodes()[n];
+	switch(node.type)
+	{
+	default:
+	case Regex_Ast::node_type::empty: return k(pos);
+	case Regex_Ast::node_type::set:
+		return pos < str.size() && node.set[static_cast<unsigned char>(str[pos])] && k(pos+1);
+	case Regex_Ast::node_type::concat:
+	{
+		std::function<bool(size_t, size_t)> rest = [&](size_t i, size_t p)
+		{
+			if(i == node.children.size()) return k(p);
+			return backtrack(ast, node.children[i], str, p, tags, [&](size_t q){ return rest(i+1, q); });
+		};
+		return rest(0, pos);
+	}
+	case Regex_Ast::node_type::alt:
+		for(size_t c : node.children)
+		{
+			if(backtrack(ast, c, str, pos, tags, k)) return true;
+		}
+		return false;
+	case Regex_Ast::node_type::capture:
+	{
+		size_t g = node.min;
+		size_t old_start = tags[2*g-2];
+		tags[2*g-2] = pos;
+		bool ok = backtrack(ast, node.children[0], str, pos, tags, [&](size_t p)
+		{
+			size_t old_end = tags[2*g-1];
+			tags[2*g-1] = p;
+			if(k(p)) return true;
+			tags[2*g-1] = old_end;
+			return false;
+		});
+		if(!ok) tags[2*g-2] = old_start;
+		return ok;
+	}
+	case Regex_Ast::node_type::repeat:
+	{
+		std::function<bool(unsigned int, size_t)> rest = [&](unsigned int i, size_t p)
+		{
+			if(i < node.min) return backtrack(ast, node.children[0], str, p, tags, [&](size_t q){ return rest(i+1, q); });
+			if(node.max == Regex_Ast::unbounded || i < node.max)
+			{
+				bool loop = node.max == Regex_Ast::unbounded;
+				if(backtrack(ast, node.children[0], str, p, tags, [&](size_t q){ return (!loop || q != p) && rest(i+1, q); })) return true;
+			}
+			return k(p);
+		};
+		return rest(0, pos);
+	}
+	}
+}
+
+bool verify_regex(std::string_view regex, const std::vector<std::string>& inputs)
+{
+	Regex_Ast ast(regex);
+	Nfa nfa(ast);
+	Glushkov_Nfa glushkov(ast);
+	Dfa subset(nfa), followpos(glushkov);
+	std::string lit;
+	std::optional<Dfa> literal;
+	if(regex_literal(regex, lit)) literal.emplace(Dfa::literal(lit));
+	std::optional<Tagged_Dfa> tagged;
+	if(ast.groups() > 0) tagged.emplace(ast);
+	//the regexes only have lowercase letters, the case folded regex has to match an input
+	//with some letters uppercased exactly when the regex matches it all lowercase
+	Dfa folded{Nfa(Regex_Ast(regex, true))};
+	bool ok = true;
+	for(const std::string& input : inputs)
+	{
+		bool expected = nfa.accepts(input);
+		std::pair<const char*, bool> results[] =
+		{
+			{"position automaton", glushkov.accepts(input)},
+			{"subset construction dfa", subset.accepts(input)},
+			{"followpos dfa", followpos.accepts(input)},
+			{"literal dfa", literal ? literal->accepts(input) : expected}
+		};
+		for(const auto& [name, result] : results)
+		{
+			if(result == expected) continue;
+			std::cerr << "error: regex '" << regex << "' input '" << printable(input) << "': thompson nfa ";
+			std::cerr << (expected ? "matches" : "doesn't match") << ", " << name << (result ? " matches\n" : " doesn't match\n");
+			ok = false;
+		}
+		std::string lower = input, mixed = input;
+		for(size_t i = 0; i < input.size(); i++)
+		{
+			if(input[i] >= 'A' && input[i] <= 'Z') lower[i] = static_cast<char>(input[i]-'A'+'a');
+			mixed[i] = i % 2 == 0 && lower[i] >= 'a' && lower[i] <= 'z' ? static_cast<char>(lower[i]-'a'+'A') : lower[i];
+		}
+		if(folded.accepts(mixed) != nfa.accepts(lower))
+		{
+			std::cerr << "error: regex '" << regex << "' input '" << printable(mixed) << "': case folded dfa ";
+			std::cerr << (folded.accepts(mixed) ? "matches" : "doesn't match") << ", thompson nfa on '" << printable(lower) << "' doesn't\n";
+			ok = false;
+		}
+		//the longest prefix the pike vm finds is what the generated nfa fallback returns
+		size_t longest = Nfa::no_match;
+		for(size_t i = 0, s = 0; s != Dfa::no_state; i++)
+		{
+			if(subset.states()[s].is_accepting) longest = i;
+			if(i == input.size()) break;
+			s = subset.transition(s, input[i]);
+		}
+		if(nfa.longest_match(input) != longest)
+		{
+			std::cerr << "error: regex '" << regex << "' input '" << printable(input) << "': pike vm longest match ";
+			std::cerr << static_cast<long long>(nfa.longest_match(input)) << ", dfa " << static_cast<long long>(longest) << '\n';
+			ok = false;
+		}
+		if(!tagged) continue;
+		std::vector<size_t> tags(2*ast.groups(), Tagged_Dfa::no_position);
+		if(!backtrack(ast, ast.root(), input, 0, tags, [&](size_t p){ return p == input.size(); })) tags.clear();
+		std::vector<size_t> result = tagged->match(input);
+		if(result != tags)
+		{
+			auto print = [](const std::vector<size_t>& v)
+			{
+				std::string ret = v.empty() ? "no match" : "";
+				for(size_t t : v) ret += (t == Tagged_Dfa::no_position ? std::string("-") : std::to_string(t)) + ' ';
+				return ret;
+			};
+			std::cerr << "error: regex '" << regex << "' input '" << printable(input) << "': tagged dfa groups ";
+			std::cerr << print(result) << ", backtracking " << print(tags) << '\n';
+			ok = false;
+		}
+	}
+	return ok;
+}
+
+bool verify_lexer(const std::vector<std::string>& regexes, std::string_view input)
+{
+	insert_order_map<std::string, token_data> token_map;
+	std::vector<Dfa> dfas;
+	for(size_t i = 0; i < regexes.size(); i++)
+	{
+		dfas.emplace_back(Nfa(regexes[i]));
+		token_map.emplace_back("t" + std::to_string(i), token_data{token_data::lex_mode::standard, dfas.back(), {}, std::nullopt, std::nullopt, std::nullopt, 0, {}, {}});
+	}
+	Lexer_Dfa lexer(token_map);
+	lexer.reorder(lexer.static_frequency());
+	const std::vector<Lexer_Dfa::state>& states = lexer;
+	bool backtrack_free = lexer.backtrack_free();
+	size_t pos = 0;
+	while(pos < input.size())
+	{
+		//the reference, the longest non empty match of each dfa on its own
+		size_t expected_token = Lexer_Dfa::no_token, expected_end = pos+1;
+		for(size_t t = 0; t < dfas.size(); t++)
+		{
+			size_t s = 0;
+			for(size_t i = pos; i < input.size(); i++)
+			{
+				s = dfas[t].transition(s, input[i]);
+				if(s == Dfa::no_state) break;
+				if(dfas[t].states()[s].is_accepting && (expected_token == Lexer_Dfa::no_token || i+1 > expected_end))
+				{
+					expected_token = t;
+					expected_end = i+1;
+				}
+			}
+		}
+		//the lexer dfa scanned the way the generated rec_match does
+		size_t token = Lexer_Dfa::no_token, end = pos+1;
+		size_t s = Lexer_Dfa::start_state;
+		for(size_t i = pos; i < input.size(); i++)
+		{
+			size_t next = states[s].transitions[static_cast<unsigned char>(input[i])];
+			if(next == Lexer_Dfa::dead_state)
+			{
+				if(backtrack_free && s != Lexer_Dfa::start_state && states[s].token == Lexer_Dfa::no_token)
+				{
+					std::cerr << "error: lexer dfa claims to be backtrack free but dies in a non accepting state at ";
+					std::cerr << i << " of input '" << printable(input) << "'\n";
+					return false;
+				}
+				break;
+			}
+			s = next;
+			if(states[s].token != Lexer_Dfa::no_token)
+			{
+				token = states[s].token;
+				end = i+1;
+			}
+			if(backtrack_free && i+1 == input.size() && states[s].token == Lexer_Dfa::no_token && token != Lexer_Dfa::no_token)
+			{
+				std::cerr << "error: lexer dfa claims to be backtrack free but the input ends in a non accepting ";
+				std::cerr << "state after an accepting one, input '" << printable(input) << "'\n";
+				return false;
+			}
+		}
+		if(token != expected_token || end != expected_end)
+		{
+			std::cerr << "error: lexer dfa on input '" << printable(input) << "' at " << pos << " matched token ";
+			std::cerr << static_cast<long long>(token) << " up to " << end << ", expected token ";
+			std::cerr << static_cast<long long>(expected_token) << " up to " << expected_end << '\n';
+			return false;
+		}
+		pos = end;
+	}
+	return true;
+}
+
+//a rule whose dfas blow up has to stop every bounded construction, the tagged dfa of
+//(?(a|b)*a(a|b){20}) once made a 632 mb header under --max-dfa-states 500
+static bool verify_limits()
+{
+	construction_limit limit;
+	limit.max_states = 500;
+	limit.max_bytes = 64 << 20;
+	Regex_Ast ast("(?(a|b)*a(a|b){20})");
+	bool ok = true;
+	if(Dfa::bounded(Nfa(ast), limit))
+	{
+		std::cerr << "error: subset construction didn't stop at the limit\n";
+		ok = false;
+	}
+	if(Dfa::bounded(Glushkov_Nfa(ast), limit))
+	{
+		std::cerr << "error: followpos construction didn't stop at the limit\n";
+		ok = false;
+	}
+	if(Tagged_Dfa::bounded(ast, limit))
+	{
+		std::cerr << "error: tagged dfa construction didn't stop at the limit\n";
+		ok = false;
+	}
+	return ok;
+}
+
+size_t run_verify(unsigned long seed, size_t cases)
+{
+	std::mt19937 rng(static_cast<std::mt19937::result_type>(seed));
+	size_t failed = verify_limits() ? 0 : 1;
+	for(size_t c = 0; c < cases; c++)
+	{
+		std::string regex = random_regex(rng);
+		Dfa dfa{Nfa(regex)};
+		std::vector<std::string> inputs;
+		for(int i = 0; i < 32; i++) inputs.push_back(random_input(rng, dfa));
+		bool ok = verify_regex(regex, inputs);
+
+		std::vector<std::string> regexes;
+		std::vector<Dfa> dfas;
+		size_t n = std::uniform_int_distribution<size_t>(1, 4)(rng);
+		for(size_t i = 0; i < n; i++)
+		{
+			regexes.push_back(random_regex(rng, 2));
+			dfas.emplace_back(Nfa(regexes.back()));
+		}
+		std::string input;
+		for(int i = 0; i < 24; i++)
+		{
+			if(std::uniform_int_distribution<int>(0, 4)(rng) == 0) input += random_char(rng);
+			else input += random_input(rng, dfas[std::uniform_int_distribution<size_t>(0, n-1)(rng)]);
+		}
+		if(!verify_lexer(regexes, input))
+		{
+			std::cerr << "error: lexer regexes:";
+			for(const std::string& r : regexes) std::cerr << " '" << r << '\'';
+			std::cerr << '\n';
+			ok = false;
+		}
+		if(!ok) failed++;
+	}
+	std::cout << "verified " << cases << " cases from seed " << seed << ", " << failed << " failed\n";
+	return failed;
+}
+
+//a rule of a random spec for the generated code check, written out as a spec line and
+//matched on its own as the reference
+struct codegen_rule
+{
+	char mode;
+	std::string regex; //without the trailing context
+	std::string context; //fixed length trailing context or empty
+	size_t context_length; //bytes the context matches
+	bool fold;
+	std::vector<std::string> conditions;
+	std::string begin;
+};
+
+struct codegen_token
+{
+	size_t kind, start, length;
+};
+
+//the driver compiled against every generated lexer, it runs each interface over the input
+//and prints one line per token, "captures" lines follow the rec_next tokens that have groups
+static constexpr const char* codegen_driver = R"(#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lexer.h"
+
+static char* read_file(const char* path, size_t* len)
+{
+	FILE* f = fopen(path, "rb");
+	char* buf;
+	long n;
+	if(!f) exit(2);
+	fseek(f, 0, SEEK_END);
+	n = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	buf = (char*)malloc((size_t)n + 1);
+	if(fread(buf, 1, (size_t)n, f) != (size_t)n) exit(2);
+	fclose(f);
+	*len = (size_t)n;
+	return buf;
+}
+
+static void print_token(const char* api, int kind, size_t start, size_t length)
+{
+	printf("%s %d %lu %lu\n", api, kind, (unsigned long)start, (unsigned long)length);
+}
+
+static void push_emit(void* ctx, int kind, const unsigned char* lexeme, size_t length, uint64_t offset, uint64_t line, uint64_t column)
+{
+	(void)ctx;
+	(void)lexeme;
+	printf("push %d %lu %lu %lu %lu\n", kind, (unsigned long)offset, (unsigned long)length, (unsigned long)line, (unsigned long)column);
+}
+
+static void lex_next(const char* api, const char* buf, size_t len, int memo)
+{
+	rec_lexer lx;
+	rec_token tk;
+	rec_position p;
+	rec_init(&lx, buf, len);
+	rec_position_init(&p);
+#ifdef REC_MEMO_BYTES
+	if(memo) rec_set_memo(&lx, (unsigned char*)calloc(REC_MEMO_BYTES(len), 1));
+#else
+	(void)memo;
+#endif
+	while(rec_next(&lx, &tk) != REC_EOF)
+	{
+		unsigned long column = (unsigned long)rec_position_advance(&p, buf, tk.start);
+		printf("%s %d %lu %lu %lu %lu\n", api, tk.kind, (unsigned long)tk.start, (unsigned long)tk.length, (unsigned long)p.line, column);
+#ifdef REC_NO_CAPTURE
+		{
+			size_t caps[2 * REC_CAPTURE_MAX_GROUPS];
+			size_t g = rec_captures(tk.kind, (const unsigned char*)buf + tk.start, tk.length, caps);
+			size_t i;
+			if(g == 0) continue;
+			printf("captures");
+			for(i = 0; i < 2 * g; i++) printf(caps[i] == REC_NO_CAPTURE ? " -" : " %lu", (unsigned long)caps[i]);
+			printf("\n");
+		}
+#endif
+	}
+}
+
+int main(int argc, char** argv)
+{
+	size_t len, edited_len, i, k;
+	char* buf;
+	unsigned int seed;
+	if(argc != 7) return 2;
+	buf = read_file(argv[1], &len);
+	seed = (unsigned int)atoi(argv[6]);
+	srand(seed);
+
+	lex_next("next", buf, len, 0);
+	lex_next("memo", buf, len, 1);
+	{
+		rec_lexer lx;
+		rec_kind kinds[4];
+		size_t starts[4], lengths[4];
+		size_t max = 1 + seed % 4, n;
+		rec_init(&lx, buf, len);
+		do
+		{
+			n = rec_next_batch(&lx, kinds, starts, lengths, max);
+			for(i = 0; i < n; i++)
+			{
+				if(kinds[i] != REC_EOF) print_token("batch", kinds[i], starts[i], lengths[i]);
+			}
+		}while(n > 0 && kinds[n - 1] != REC_EOF);
+	}
+	{
+		/* half the input is fed to one lexer, the rest to another one restored from its snapshot */
+		rec_push a, b;
+		unsigned char* snapshot;
+		size_t size;
+		rec_push_init(&a, (unsigned char*)malloc(len + 1), len + 1);
+		for(i = 0; i < len / 2; i += k)
+		{
+			k = 1 + (size_t)rand() % 5;
+			if(k > len / 2 - i) k = len / 2 - i;
+			rec_push_feed(&a, buf + i, k, push_emit, NULL);
+		}
+		snapshot = (unsigned char*)malloc(REC_SNAPSHOT_SIZE(&a));
+		size = rec_push_snapshot(&a, snapshot);
+		rec_push_init(&b, (unsigned char*)malloc(len + 1), len + 1);
+		if(!rec_push_restore(&b, snapshot, size)) printf("push restore failed\n");
+		for(i = (size_t)(b.offset + b.count); i < len; i += k)
+		{
+			k = 1 + (size_t)rand() % 5;
+			if(k > len - i) k = len - i;
+			rec_push_feed(&b, buf + i, k, push_emit, NULL);
+		}
+		rec_push_finish(&b, push_emit, NULL);
+	}
+#ifndef REC_COND_COUNT
+	{
+		/* the stream is lexed on the input and then edited into the edited input */
+		char* edited = read_file(argv[2], &edited_len);
+		size_t cap = len + edited_len + 2;
+		rec_stream st;
+		st.kinds = (rec_kind*)malloc(cap * sizeof(rec_kind));
+		st.starts = (size_t*)malloc(cap * sizeof(size_t));
+		st.lengths = (size_t*)malloc(cap * sizeof(size_t));
+		st.reaches = (size_t*)malloc(cap * sizeof(size_t));
+		st.capacity = cap;
+		if(!rec_stream_lex(&st, buf, len) || !rec_stream_edit(&st, edited, edited_len,
+			(size_t)atol(argv[3]), (size_t)atol(argv[4]), (size_t)atol(argv[5]))) printf("stream capacity ran out\n");
+		for(i = 0; i < st.count; i++)
+		{
+			if(st.kinds[i] != REC_EOF) print_token("stream", st.kinds[i], st.starts[i], st.lengths[i]);
+		}
+	}
+	{
+		size_t n = 1 + seed % 4;
+		rec_chunk chunks[4];
+		for(k = 0; k < n; k++)
+		{
+			chunks[k].begin = len * k / n;
+			chunks[k].end = len * (k + 1) / n;
+			chunks[k].capacity = chunks[k].end - chunks[k].begin + 1;
+			chunks[k].kinds = (rec_kind*)malloc(chunks[k].capacity * sizeof(rec_kind));
+			chunks[k].starts = (size_t*)malloc(chunks[k].capacity * sizeof(size_t));
+			chunks[k].lengths = (size_t*)malloc(chunks[k].capacity * sizeof(size_t));
+		}
+		rec_lex_parallel(buf, len, chunks, n);
+		for(k = 0; k < n; k++)
+		{
+			for(i = 0; i < chunks[k].count; i++) print_token("parallel", chunks[k].kinds[i], chunks[k].starts[i], chunks[k].lengths[i]);
+		}
+#ifdef REC_COMPOSED
+		{
+			size_t tail = rec_lex_composed(buf, len, chunks, n);
+			for(k = 0; k < n; k++)
+			{
+				for(i = 0; i < chunks[k].count; i++) print_token("composed", chunks[k].kinds[i], chunks[k].starts[i], chunks[k].lengths[i]);
+			}
+			if(tail < len)
+			{
+				rec_lexer lx;
+				rec_token tk;
+				rec_init(&lx, buf, len);
+				lx.pos = tail;
+				while(rec_next(&lx, &tk) != REC_EOF) print_token("composed", tk.kind, tk.start, tk.length);
+			}
+		}
+#endif
+	}
+#else
+	(void)edited_len;
+#endif
+	return 0;
+}
+)";
+
+//maximal munch over the rules matched on their own, the earliest rule wins a tie and a
+//byte no rule matches is an unmatched token, every token including ignored ones
+static std::vector<codegen_token> munch(const std::vector<codegen_rule>& rules, const std::vector<Dfa>& dfas,
+	std::string_view input)
+{
+	std::vector<codegen_token> ret;
+	std::string cond = "initial";
+	size_t pos = 0;
+	while(pos < input.size())
+	{
+		size_t kind = rules.size()+1, end = pos+1, match = pos;
+		for(size_t t = 0; t < rules.size(); t++)
+		{
+			const codegen_rule& r = rules[t];
+			bool active = r.conditions.empty() ? cond == "initial"
+				: std::find(r.conditions.cbegin(), r.conditions.cend(), cond) != r.conditions.cend() || r.conditions[0] == "*";
+			if(!active) continue;
+			size_t s = 0;
+			for(size_t i = pos; i < input.size(); i++)
+			{
+				s = dfas[t].transition(s, input[i]);
+				if(s == Dfa::no_state) break;
+				if(dfas[t].states()[s].is_accepting && i+1 > match)
+				{
+					kind = t;
+					match = i+1;
+				}
+			}
+		}
+		//trailing context counts toward the longest match but isn't part of the lexeme
+		if(kind < rules.size()) end = match-rules[kind].context_length;
+		if(kind < rules.size() && !rules[kind].begin.empty()) cond = rules[kind].begin;
+		ret.push_back({kind, pos, end-pos});
+		pos = end;
+	}
+	return ret;
+}
+
+//one random spec, generated with random options, compiled with the driver and run, the
+//output of every interface has to be the reference tokenization
+static bool verify_codegen_case(std::mt19937& rng, unsigned long seed, size_t c, const lexer_generator& generate)
+{
+	std::uniform_int_distribution<int> percent(0, 99);
+	options opts;
+	opts.keyword_split = percent(rng) < 30;
+	opts.bit_parallel = percent(rng) < 30;
+	opts.direct_dfa = percent(rng) < 30;
+	if(percent(rng) < 20) opts.dfa_budget = 4;
+	bool conditions = percent(rng) < 30;
+	static constexpr const char modes[] = ".-+!";
+	static constexpr const char* contexts[] = {"c", "ab", "/s"};
+	static constexpr const char* literals[] = {"ab", "ba", "abc", "cc"};
+	static constexpr const char* condition_names[] = {"s1", "s2"};
+
+	std::vector<codegen_rule> rules;
+	auto add_rule = [&](std::string regex)
+	{
+		codegen_rule r{modes[percent(rng) % 4], std::move(regex), "", 0, percent(rng) < 15, {}, ""};
+		if(percent(rng) < 15) r.context = contexts[percent(rng) % 3];
+		if(conditions && percent(rng) < 50)
+		{
+			if(percent(rng) < 30) r.conditions.push_back("*");
+			else for(const char* n : condition_names) if(r.conditions.empty() || percent(rng) < 50) r.conditions.push_back(n);
+		}
+		if(conditions && percent(rng) < 30) r.begin = percent(rng) < 30 ? "initial" : condition_names[percent(rng) % 2];
+		//regexes rec rejects (trailing context after one that can match nothing) are left plain
+		try
+		{
+			Regex_Ast ast(r.regex + (r.context.empty() ? "" : "(?=" + r.context + ")"));
+			if(!r.context.empty()) r.context_length = ast.length_bounds(ast.trail()).first;
+		}catch(const Regex_Exception&)
+		{
+			r.context.clear();
+		}
+		rules.push_back(std::move(r));
+	};
+	if(opts.keyword_split)
+	{
+		for(const char* l : literals) if(percent(rng) < 50) add_rule(l);
+	}
+	size_t n = std::uniform_int_distribution<size_t>(1, 4)(rng);
+	for(size_t i = 0; i < n; i++) add_rule(random_regex(rng, 2));
+	//a rule with more dfa states than positions so it is simulated instead
+	if((opts.bit_parallel || opts.dfa_budget != 0) && percent(rng) < 70) add_rule("(a|b)*a(a|b){3}");
+	if(opts.keyword_split) add_rule("[a-c]+");
+	//a condition switched to has to have a rule active in it
+	if(conditions)
+	{
+		add_rule(random_regex(rng, 2));
+		rules.back().conditions = {condition_names[0], condition_names[1]};
+	}
+
+	//with --dfa-budget a rule whose tagged dfa goes over it loses its groups
+	std::vector<Dfa> dfas;
+	std::vector<std::optional<Tagged_Dfa>> tagged;
+	for(const codegen_rule& r : rules)
+	{
+		Regex_Ast ast(r.regex + (r.context.empty() ? "" : "(?=" + r.context + ")"), r.fold);
+		dfas.emplace_back(Nfa(ast));
+		tagged.emplace_back();
+		if(ast.groups() > 0) tagged.back() = Tagged_Dfa::bounded(ast, dfa_limit(opts));
+	}
+	auto random_text = [&]()
+	{
+		std::string ret;
+		for(int i = 0; i < 12; i++)
+		{
+			if(percent(rng) < 20) ret += "abcAB \n"[percent(rng) % 7];
+			else ret += random_input(rng, dfas[std::uniform_int_distribution<size_t>(0, dfas.size()-1)(rng)]);
+		}
+		return ret;
+	};
+	std::string input = random_text();
+	std::string edited = input;
+	size_t edit_start = std::uniform_int_distribution<size_t>(0, input.size())(rng);
+	size_t old_end = std::uniform_int_distribution<size_t>(edit_start, std::min(input.size(), edit_start+6))(rng);
+	std::string inserted = random_text().substr(0, static_cast<size_t>(percent(rng) % 6));
+	edited.replace(edit_start, old_end-edit_start, inserted);
+	size_t new_end = edit_start+inserted.size();
+
+	namespace fs = std::filesystem;
+	fs::path dir = fs::temp_directory_path() / ("rec_verify_" + std::to_string(seed) + "_" + std::to_string(c));
+	fs::create_directories(dir);
+	std::ofstream spec(dir / "spec.txt");
+	for(size_t i = 0; i < rules.size(); i++)
+	{
+		const codegen_rule& r = rules[i];
+		spec << r.mode;
+		for(size_t j = 0; j < r.conditions.size(); j++) spec << (j == 0 ? "<" : ",") << r.conditions[j] << (j+1 == r.conditions.size() ? ">" : "");
+		spec << (r.fold ? "~" : "") << 't' << i << (r.begin.empty() ? "" : ">" + r.begin) << ' ' << r.regex;
+		spec << (r.context.empty() ? "" : "(?=" + r.context + ")") << '\n';
+	}
+	spec.close();
+	std::ofstream(dir / "input.txt", std::ios::binary) << input;
+	std::ofstream(dir / "edited.txt", std::ios::binary) << edited;
+	std::ofstream(dir / "driver.c") << codegen_driver;
+	std::string spec_path = (dir / "spec.txt").string(), lexer_path = (dir / "lexer.h").string();
+	opts.input = spec_path.c_str();
+	opts.output = lexer_path.c_str();
+	generate(opts);
+
+	const char* cc = std::getenv("CC");
+	std::string d = dir.string();
+	std::string compile = std::string(cc ? cc : "cc") + " -std=c99 -O1 -Wall -Wextra -Werror -o " + d + "/driver " + d + "/driver.c 2> " + d + "/cc.txt";
+	if(std::system(compile.c_str()) != 0)
+	{
+		std::cerr << "error: the lexer generated from " << spec_path << " doesn't compile, see " << d << "/cc.txt\n";
+		return false;
+	}
+	std::string run = d + "/driver " + d + "/input.txt " + d + "/edited.txt " + std::to_string(edit_start) + ' ' +
+		std::to_string(old_end) + ' ' + std::to_string(new_end) + ' ' + std::to_string(c) + " > " + d + "/output.txt";
+	if(std::system(run.c_str()) != 0)
+	{
+		std::cerr << "error: the driver of " << spec_path << " failed\n";
+		return false;
+	}
+
+	auto ignored = [&](size_t kind){ return kind < rules.size() && rules[kind].mode == '-'; };
+	auto line = [](const std::string& api, const codegen_token& t)
+	{
+		return api + ' ' + std::to_string(t.kind) + ' ' + std::to_string(t.start) + ' ' + std::to_string(t.length) + '\n';
+	};
+	std::vector<codegen_token> tokens = munch(rules, dfas, input);
+	std::string expected;
+	for(const char* api : {"next", "memo"})
+	{
+		size_t ln = 1, line_start = 0, scanned = 0;
+		for(const codegen_token& t : tokens)
+		{
+			for(; scanned < t.start; scanned++)
+			{
+				if(input[scanned] == '\n')
+				{
+					ln++;
+					line_start = scanned+1;
+				}
+			}
+			if(ignored(t.kind)) continue;
+			std::string l = line(api, t);
+			l.pop_back();
+			expected += l + ' ' + std::to_string(ln) + ' ' + std::to_string(t.start-line_start+1) + '\n';
+			if(t.kind >= rules.size() || !tagged[t.kind]) continue;
+			std::vector<size_t> caps = tagged[t.kind]->match(input.substr(t.start, t.length));
+			if(caps.empty()) continue;
+			expected += "captures";
+			for(size_t p : caps) expected += p == Tagged_Dfa::no_position ? std::string(" -") : ' ' + std::to_string(p);
+			expected += '\n';
+		}
+	}
+	for(const codegen_token& t : tokens)
+	{
+		if(!ignored(t.kind)) expected += line("batch", t);
+	}
+	{
+		size_t ln = 1, line_start = 0, scanned = 0;
+		for(const codegen_token& t : tokens)
+		{
+			for(; scanned < t.start; scanned++)
+			{
+				if(input[scanned] == '\n')
+				{
+					ln++;
+					line_start = scanned+1;
+				}
+			}
+			if(ignored(t.kind)) continue;
+			std::string l = line("push", t);
+			l.pop_back();
+			expected += l + ' ' + std::to_string(ln) + ' ' + std::to_string(t.start-line_start+1) + '\n';
+		}
+	}
+	if(!conditions)
+	{
+		for(const codegen_token& t : munch(rules, dfas, edited))
+		{
+			if(!ignored(t.kind)) expected += line("stream", t);
+		}
+		for(const codegen_token& t : tokens)
+		{
+			if(!ignored(t.kind)) expected += line("parallel", t);
+		}
+	}
+	std::ifstream out(dir / "output.txt", std::ios::binary);
+	std::string actual((std::istreambuf_iterator<char>(out)), std::istreambuf_iterator<char>());
+	//rec_lex_composed is only there for some lexers, its lines have to be the parallel ones
+	std::string composed;
+	for(size_t at = actual.find("composed "); at != std::string::npos; at = actual.find("composed ", at))
+	{
+		size_t end = actual.find('\n', at)+1;
+		composed += "parallel" + actual.substr(at+8, end-at-8);
+		actual.erase(at, end-at);
+	}
+	if(!composed.empty() && expected.find(composed) == std::string::npos) actual += "composed tokens differ from the parallel ones\n";
+	if(actual != expected)
+	{
+		size_t at = 0;
+		while(at < actual.size() && at < expected.size() && actual[at] == expected[at]) at++;
+		at = expected.rfind('\n', at) == std::string::npos ? 0 : expected.rfind('\n', at)+1;
+		std::cerr << "error: generated lexer of " << spec_path << " on input '" << printable(input) << "' differs from maximal munch, expected\n";
+		std::cerr << expected.substr(at, expected.find('\n', at)-at) << "\ngot\n" << actual.substr(at, actual.find('\n', at)-at) << '\n';
+		return false;
+	}
+	fs::remove_all(dir);
+	return true;
+}
+
+size_t run_verify_codegen(unsigned long seed, size_t cases, const lexer_generator& generate)
+{
+	std::mt19937 rng(static_cast<std::mt19937::result_type>(seed));
+	size_t failed = 0;
+	for(size_t c = 0; c < cases; c++)
+	{
+		if(!verify_codegen_case(rng, seed, c, generate)) failed++;
+	}
+	std::cout << "verified " << cases << " generated lexers from seed " << seed << ", " << failed << " failed\n";
+	return failed;
+}
+
+#ifdef REC_FUZZ
+//libfuzzer entry point, the first line holds tab separated regexes and every following line
+//is an input, a single regex is checked on its own and every set of regexes as a lexer
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	std::string_view str(reinterpret_cast<const char*>(data), size);
+	size_t line = str.find('\n');
+	std::string_view head = str.substr(0, line);
+	//counted repeats multiply the automaton, keep single digit counts so runs stay fast
+	for(size_t i = 1; i < head.size(); i++)
+	{
+		if(head[i-1] >= '0' && head[i-1] <= '9' && head[i] >= '0' && head[i] <= '9') return 0;
+	}
+	std::vector<std::string> regexes;
+	while(true)
+	{
+		size_t tab = head.find('\t');
+		regexes.emplace_back(head.substr(0, tab));
+		if(tab == std::string_view::npos) break;
+		head.remove_prefix(tab+1);
+	}
+	std::vector<std::string> inputs;
+	while(line != std::string_view::npos)
+	{
+		str.remove_prefix(line+1);
+		line = str.find('\n');
+		inputs.emplace_back(str.substr(0, line));
+	}
+	try
+	{
+		for(const std::string& regex : regexes)
+		{
+			if(!verify_regex(regex, inputs)) std::abort();
+		}
+		for(const std::string& input : inputs)
+		{
+			if(!verify_lexer(regexes, input)) std::abort();
+		}
+	}catch(const Regex_Exception&)
+	{
+		//not a valid regex, nothing to compare
+	}
+	return 0;
+}
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+#include "input_parse.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <random>
+#include <functional>
+
+//differential checks of the automaton constructions against each other, every way rec can
+//turn a regex into a matcher has to agree with the others on every input
+
+//random regex in the grammar of regex_ast.cpp over a small alphabet so inputs hit it often
+std::string random_regex(std::mt19937& rng, unsigned int depth = 3);
+
+//checks the thompson nfa, the position automaton and both dfas built from them agree on
+//whether each input is matched and the pike vm finds the same longest matched prefix as the
+//dfa, prints the disagreement to std::cerr and returns false if not
+//throws Regex_Exception if the regex is invalid
+bool verify_regex(std::string_view regex, const std::vector<std::string>& inputs);
+
+//checks the minimized, pruned and reordered lexer dfa splits input into the same tokens as
+//maximal munch over the separate dfa of every regex (earliest regex wins a tie)
+bool verify_lexer(const std::vector<std::string>& regexes, std::string_view input);
+
+//runs cases random regexes and lexers from seed, returns the number of failed cases
+size_t run_verify(unsigned long seed, size_t cases);
+
+//generates the lexer of the spec file opts.input into opts.output
+typedef std::function<void(const options&)> lexer_generator;
+
+//generates lexers for cases random specs with random options, compiles each one with a
+//driver (with $CC, cc by default) that runs rec_next, rec_next_batch, the memo, the push
+//lexer through a snapshot, a stream edit, rec_lex_parallel, rec_lex_composed, captures,
+//trailing context and line counting over a random input, and checks every interface
+//returns the tokens of maximal munch over the rules matched on their own, returns the
+//number of failed cases, their files are left in the temporary directory
+size_t run_verify_codegen(unsigned long seed, size_t cases, const lexer_generator& generate);